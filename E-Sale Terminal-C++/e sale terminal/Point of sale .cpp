@@ -4,11 +4,53 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <numeric>
 #include <vector>
 #include <queue>
 #include <stack>
 #include <limits>  // Needed for numeric_limits<streamsize>::max()
 #include <cctype>
+#include <cmath>
+#include <charconv>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <chrono>
+#include <random>
+#include <deque>
+#include <unordered_map>
+#include <map>
+#include <set>
+#include <ctime>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#endif
 
 using namespace std;
 
@@ -106,817 +148,4204 @@ public:
     }
 };
 
+// Unit price after discount and tax
+double finalUnitPrice(const Product& product) {
+    double discountedPrice = product.price * (1 - product.discount / 100);
+    return discountedPrice * (1 + product.tax / 100);
+}
+
+// Product date as yyyymmdd. products.csv has both "YYYY-MM-DD" and "DD/MM/YYYY".
+bool dateKey(const string& text, int& key) {
+    int year, month, day;
+    auto number = [&](size_t at, size_t length, int& value) {
+        return all_of(text.begin() + at, text.begin() + at + length, ::isdigit)
+            && from_chars(text.data() + at, text.data() + at + length, value).ec == errc();
+    };
+    bool parsed = text.size() == 10 && ((text[4] == '-' && text[7] == '-'
+        && number(0, 4, year) && number(5, 2, month) && number(8, 2, day))
+        || (text[2] == '/' && text[5] == '/'
+        && number(6, 4, year) && number(3, 2, month) && number(0, 2, day)));
+    if (!parsed || month < 1 || month > 12 || day < 1 || day > 31)
+        return false;
+    key = year * 10000 + month * 100 + day;
+    return true;
+}
+
+// --------------------- Product CSV Schema ---------------------
+// The product row layout, described once. Readers and writers for
+// products.csv, wishlist.csv, report.csv and bulk imports are all generated
+// from this column list, so adding a column here updates every file. The
+// columns are walked with fold expressions, so each routine is unrolled at
+// compile time and works straight on the line buffer (no token vectors or
+// stringstreams).
+template <auto Member>
+struct Column {
+    static constexpr auto member = Member;
+    const char* header;
+};
+
+constexpr auto productColumns = make_tuple(
+    Column<&Product::id>{ "ID" },
+    Column<&Product::name>{ "Name" },
+    Column<&Product::category>{ "Category" },
+    Column<&Product::price>{ "Price" },
+    Column<&Product::quantity>{ "Quantity" },
+    Column<&Product::discount>{ "Discount" },
+    Column<&Product::tax>{ "Tax" },
+    Column<&Product::Date>{ "Expiry Date" });
+
+// Exact: shortest text that reads back to the same value (data files).
+// Report: money-style two decimals for every floating point column.
+enum class CsvStyle { Exact, Report };
+
+// Numeric fields are as lenient as stoi/stod were: leading spaces are
+// skipped and anything after the number (e.g. ".5" in an int) is ignored.
+bool parseField(string_view text, int& value) {
+    while (!text.empty() && text.front() == ' ')
+        text.remove_prefix(1);
+    if (!text.empty() && text.front() == '+')
+        text.remove_prefix(1);
+    return from_chars(text.data(), text.data() + text.size(), value).ec == errc();
+}
+
+bool parseField(string_view text, double& value) {
+    while (!text.empty() && text.front() == ' ')
+        text.remove_prefix(1);
+    if (!text.empty() && text.front() == '+')
+        text.remove_prefix(1);
+    return from_chars(text.data(), text.data() + text.size(), value).ec == errc();
+}
+
+bool parseField(string_view text, string& value) {
+    value.assign(text.data(), text.size());
+    return true;
+}
+
+template <CsvStyle Style>
+void appendField(string& out, int value) {
+    char buffer[16];
+    out.append(buffer, to_chars(buffer, buffer + sizeof(buffer), value).ptr);
+}
+
+template <CsvStyle Style>
+void appendField(string& out, double value) {
+    char buffer[64];
+    if constexpr (Style == CsvStyle::Report)
+        out.append(buffer, to_chars(buffer, buffer + sizeof(buffer), value, chars_format::fixed, 2).ptr);
+    else
+        out.append(buffer, to_chars(buffer, buffer + sizeof(buffer), value).ptr);
+}
+
+template <CsvStyle Style>
+void appendField(string& out, const string& value) {
+    out += value;
+}
+
+// Parse the field starting at position; the last column must end the line
+template <typename Field>
+bool parseNextField(string_view line, size_t& position, bool last, Field& field) {
+    if (position > line.size())
+        return false;
+    size_t comma = line.find(',', position);
+    if (last ? comma != string_view::npos : comma == string_view::npos)
+        return false;
+    size_t end = last ? line.size() : comma;
+    bool parsed = parseField(line.substr(position, end - position), field);
+    position = end + 1;
+    return parsed;
+}
+
+// Fill record from one CSV row laid out by columns; false if it does not match
+template <typename Record, typename Columns>
+bool parseRecordCSV(string_view line, Record& record, const Columns& columns) {
+    if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+    size_t position = 0;
+    size_t index = 0;
+    bool parsed = true;
+    apply([&](const auto&... column) {
+        ((parsed = parsed && parseNextField(line, position, ++index == tuple_size_v<Columns>,
+            record.*(decay_t<decltype(column)>::member))), ...);
+        }, columns);
+    return parsed;
+}
+
+// Append one CSV row (with trailing newline) to out
+template <CsvStyle Style, typename Record, typename Columns>
+void appendRecordCSV(string& out, const Record& record, const Columns& columns) {
+    size_t index = 0;
+    apply([&](const auto&... column) {
+        ((out += (index++ ? "," : ""),
+            appendField<Style>(out, record.*(decay_t<decltype(column)>::member))), ...);
+        }, columns);
+    out += '\n';
+}
+
+template <typename Columns>
+string recordCSVHeader(const Columns& columns) {
+    string header;
+    size_t index = 0;
+    apply([&](const auto&... column) {
+        ((header += (index++ ? "," : ""), header += column.header), ...);
+        }, columns);
+    return header + "\n";
+}
+
+bool parseProductCSV(string_view line, Product& product) {
+    return parseRecordCSV(line, product, productColumns);
+}
+
+template <CsvStyle Style>
+void appendProductCSV(string& out, const Product& product) {
+    appendRecordCSV<Style>(out, product, productColumns);
+}
+
+string productCSVHeader() {
+    return recordCSVHeader(productColumns);
+}
+
 // --------------------- Binary Search Tree ---------------------
+// Nodes are immutable and shared: every edit copies only the path from the
+// root to the changed node (and rebalances it, AVL style). Older roots stay
+// valid, which lets a snapshot of the whole catalog be taken in O(1).
+struct TreeNode;
+using TreeNodePtr = shared_ptr<const TreeNode>;
+
 struct TreeNode {
     Product product;
-    TreeNode* left;
-    TreeNode* right;
+    TreeNodePtr left;
+    TreeNodePtr right;
+    int height;
+
+    TreeNode(const Product& p, TreeNodePtr l, TreeNodePtr r)
+        : product(p), left(move(l)), right(move(r)),
+        height(1 + max(left ? left->height : 0, right ? right->height : 0)) {
+    }
+};
+
+// Read-only view of the catalog at one point in time. Later edits to the
+// tree never affect a snapshot that is already held, so readers can scan a
+// pinned snapshot without locks while sales keep publishing new versions.
+class CatalogSnapshot {
+private:
+    TreeNodePtr root;
+    unsigned long long version;
+    unsigned long long sequence;
+
+    friend class ProductTree;
 
-    TreeNode(Product p) : product(p), left(nullptr), right(nullptr) {}
+    template <typename Visitor>
+    static void inorder(const TreeNode* node, Visitor& visit) {
+        if (!node) return;
+        inorder(node->left.get(), visit);
+        visit(node->product);
+        inorder(node->right.get(), visit);
+    }
+
+public:
+    explicit CatalogSnapshot(TreeNodePtr root = nullptr, unsigned long long version = 0,
+        unsigned long long sequence = 0)
+        : root(move(root)), version(version), sequence(sequence) {
+    }
+
+    // Increases by one with every published edit
+    unsigned long long getVersion() const {
+        return version;
+    }
+
+    // Order-log sequence number of the last logged sale this version contains
+    unsigned long long getSequence() const {
+        return sequence;
+    }
+
+    const Product* search(int id) const {
+        const TreeNode* node = root.get();
+        while (node && node->product.id != id)
+            node = (id < node->product.id) ? node->left.get() : node->right.get();
+        return (node ? &node->product : nullptr);
+    }
+
+    // Calls visit(product) for every product in ID order
+    template <typename Visitor>
+    void forEach(Visitor visit) const {
+        inorder(root.get(), visit);
+    }
+
+    vector<Product> getAllProducts() const {
+        vector<Product> products;
+        forEach([&](const Product& product) { products.push_back(product); });
+        return products;
+    }
 };
 
+// Multi-version catalog: the current version is an immutable snapshot that
+// writers replace atomically. Writers are serialised by writeLock; readers
+// only do an atomic load of the current version and never wait for a sale.
+// Old versions are freed when the last reader drops its snapshot.
 class ProductTree {
 private:
-    TreeNode* root;
+    shared_ptr<const CatalogSnapshot> current;
+    mutex writeLock;
+
+    // Caller holds writeLock
+    void publish(TreeNodePtr newRoot, bool logged = false) {
+        auto next = make_shared<const CatalogSnapshot>(move(newRoot), current->version + 1,
+            current->sequence + (logged ? 1 : 0));
+        atomic_store(&current, shared_ptr<const CatalogSnapshot>(move(next)));
+    }
+
+    // Logged edits (sequence set) take the next order-log sequence number
+    template <typename Change>
+    bool edit(int id, Change& change, unsigned long long* sequence) {
+        lock_guard<mutex> guard(writeLock);
+        const Product* stored = current->search(id);
+        if (!stored)
+            return false;
+        Product edited = *stored;
+        if (!change(edited))
+            return false;
+        edited.id = id;
+        publish(replace(current->root, edited), sequence != nullptr);
+        if (sequence)
+            *sequence = current->sequence;
+        return true;
+    }
+
+    static int height(const TreeNodePtr& node) {
+        return node ? node->height : 0;
+    }
+
+    static TreeNodePtr makeNode(const Product& product, const TreeNodePtr& left,
+        const TreeNodePtr& right) {
+        return make_shared<const TreeNode>(product, left, right);
+    }
+
+    // Build a node from its parts, rotating if the subtrees differ in height by 2
+    static TreeNodePtr balance(const Product& product, const TreeNodePtr& left,
+        const TreeNodePtr& right) {
+        int diff = height(left) - height(right);
+        if (diff > 1) {
+            if (height(left->left) >= height(left->right))
+                return makeNode(left->product, left->left,
+                    makeNode(product, left->right, right));
+            const TreeNodePtr& pivot = left->right;
+            return makeNode(pivot->product,
+                makeNode(left->product, left->left, pivot->left),
+                makeNode(product, pivot->right, right));
+        }
+        if (diff < -1) {
+            if (height(right->right) >= height(right->left))
+                return makeNode(right->product,
+                    makeNode(product, left, right->left), right->right);
+            const TreeNodePtr& pivot = right->left;
+            return makeNode(pivot->product,
+                makeNode(product, left, pivot->left),
+                makeNode(right->product, pivot->right, right->right));
+        }
+        return makeNode(product, left, right);
+    }
 
-    TreeNode* insert(TreeNode* node, Product product) {
+    // Caller has checked that the id is not already present
+    static TreeNodePtr insert(const TreeNodePtr& node, const Product& product) {
         if (node == nullptr)
-            return new TreeNode(product);
+            return makeNode(product, nullptr, nullptr);
         if (product.id < node->product.id)
-            node->left = insert(node->left, product);
-        else
-            node->right = insert(node->right, product);
-        return node;
+            return balance(node->product, insert(node->left, product), node->right);
+        return balance(node->product, node->left, insert(node->right, product));
     }
 
-    // Search by product id (integer)
-    TreeNode* search(TreeNode* node, int id) {
-        if (node == nullptr || node->product.id == id)
-            return node;
-        if (id < node->product.id)
-            return search(node->left, id);
-        return search(node->right, id);
+    // Perfectly balanced tree over products sorted by id
+    static TreeNodePtr buildBalanced(const vector<const Product*>& products,
+        size_t begin, size_t end) {
+        if (begin >= end)
+            return nullptr;
+        size_t middle = begin + (end - begin) / 2;
+        return makeNode(*products[middle], buildBalanced(products, begin, middle),
+            buildBalanced(products, middle + 1, end));
+    }
+
+    // Swap in a new version of the product with the same id (shape is unchanged)
+    static TreeNodePtr replace(const TreeNodePtr& node, const Product& product) {
+        if (product.id == node->product.id)
+            return makeNode(product, node->left, node->right);
+        if (product.id < node->product.id)
+            return makeNode(node->product, replace(node->left, product), node->right);
+        return makeNode(node->product, node->left, replace(node->right, product));
+    }
+
+    static TreeNodePtr removeMin(const TreeNodePtr& node) {
+        if (node->left == nullptr)
+            return node->right;
+        return balance(node->product, removeMin(node->left), node->right);
     }
 
     // delete by product id
-    TreeNode* deleteNode(TreeNode* root, int id) {
-        if (root == nullptr)
-            return root;
-        if (id < root->product.id) {
-            root->left = deleteNode(root->left, id);
-        }
-        else if (id > root->product.id) {
-            root->right = deleteNode(root->right, id);
+    static TreeNodePtr deleteNode(const TreeNodePtr& node, int id) {
+        if (node == nullptr)
+            return node;
+        if (id < node->product.id)
+            return balance(node->product, deleteNode(node->left, id), node->right);
+        if (id > node->product.id)
+            return balance(node->product, node->left, deleteNode(node->right, id));
+        if (node->left == nullptr)
+            return node->right;
+        if (node->right == nullptr)
+            return node->left;
+        const TreeNode* successor = node->right.get();
+        while (successor->left != nullptr) {
+            successor = successor->left.get();
         }
-        else {
-            if (root->left == nullptr) {
-                TreeNode* temp = root->right;
-                delete root;
-                return temp;
+        return balance(successor->product, node->left, removeMin(node->right));
+    }
+
+public:
+    ProductTree() : current(make_shared<const CatalogSnapshot>()) {}
+
+    // Add a new product; false (and no change) if the id is already taken
+    bool insert(const Product& product) {
+        lock_guard<mutex> guard(writeLock);
+        if (current->search(product.id))
+            return false;
+        publish(insert(current->root, product));
+        return true;
+    }
+
+    // Merge a batch of products, sorted by id with no repeated ids, into the
+    // catalog as a single new version. New ids are added; for ids already in
+    // the catalog merge(stored, incoming) edits the stored copy. The result is
+    // rebuilt as a balanced tree in one O(n + m) pass instead of m inserts.
+    template <typename Merge>
+    void bulkMerge(const vector<Product>& incoming, Merge merge) {
+        bulkMergeIf(incoming, [](const Product&) { return true; },
+            [&](Product& stored, const Product& supplied) { merge(stored, supplied); return true; });
+    }
+
+    // bulkMerge that can turn rows away under the write lock: a new id is
+    // added only if admit(incoming) holds, and a stored product keeps its
+    // current record when merge(stored, incoming) returns false.
+    template <typename Admit, typename Merge>
+    void bulkMergeIf(const vector<Product>& incoming, Admit admit, Merge merge) {
+        lock_guard<mutex> guard(writeLock);
+        vector<const Product*> existing;
+        current->forEach([&](const Product& product) { existing.push_back(&product); });
+
+        deque<Product> mergedRecords;  // Stable addresses for edited products
+        vector<const Product*> result;
+        result.reserve(existing.size() + incoming.size());
+        size_t i = 0, j = 0;
+        while (i < existing.size() || j < incoming.size()) {
+            if (j == incoming.size() || (i < existing.size() && existing[i]->id < incoming[j].id)) {
+                result.push_back(existing[i++]);
             }
-            else if (root->right == nullptr) {
-                TreeNode* temp = root->left;
-                delete root;
-                return temp;
+            else if (i == existing.size() || incoming[j].id < existing[i]->id) {
+                if (admit(incoming[j]))
+                    result.push_back(&incoming[j]);
+                j++;
             }
-            TreeNode* successor = root->right;
-            while (successor->left != nullptr) {
-                successor = successor->left;
+            else {
+                mergedRecords.push_back(*existing[i]);
+                if (merge(mergedRecords.back(), incoming[j++])) {
+                    result.push_back(&mergedRecords.back());
+                }
+                else {
+                    mergedRecords.pop_back();
+                    result.push_back(existing[i]);
+                }
+                i++;
             }
-            root->product = successor->product;
-            root->right = deleteNode(root->right, successor->product.id);
         }
-        return root;
+        publish(buildBalanced(result, 0, result.size()));
     }
 
-    void inorder(TreeNode* node, vector<Product>& result) {
-        if (!node) return;
-        inorder(node->left, result);
-        result.push_back(node->product);
-        inorder(node->right, result);
+    // Search by id (integer). The pointer stays valid until the next edit;
+    // code running alongside other threads should pin a snapshot() instead.
+    const Product* search(int id) const {
+        return atomic_load(&current)->search(id);
     }
 
-public:
-    ProductTree() : root(nullptr) {}
+    // Store an edited copy of an existing product; false if the id is unknown
+    bool replace(const Product& product) {
+        return update(product.id, [&](Product& stored) {
+            stored = product;
+            return true;
+        });
+    }
+
+    // Atomic read-modify-write of one product. change(product) edits a copy
+    // and returns false to abandon the edit. Returns true if it was published.
+    template <typename Change>
+    bool update(int id, Change change) {
+        return edit(id, change, nullptr);
+    }
 
-    void insert(Product product) {
-        root = insert(root, product);
+    // update() for a sale that goes in the order log. The new version takes
+    // the next log sequence number, so any snapshot knows exactly which
+    // logged sales it already contains.
+    template <typename Change>
+    bool updateLogged(int id, Change change, unsigned long long& sequence) {
+        return edit(id, change, &sequence);
     }
 
-    // Search by id (integer)
-    Product* search(int id) {
-        TreeNode* result = search(root, id);
-        return (result ? &result->product : nullptr);
+    // Continue log numbering after sequence (set once the log has been read)
+    void restoreSequence(unsigned long long sequence) {
+        lock_guard<mutex> guard(writeLock);
+        auto next = make_shared<const CatalogSnapshot>(current->root, current->version + 1, sequence);
+        atomic_store(&current, shared_ptr<const CatalogSnapshot>(move(next)));
     }
 
     void deleteProduct(int id) {
-        root = deleteNode(root, id);
+        lock_guard<mutex> guard(writeLock);
+        publish(deleteNode(current->root, id));
     }
 
-    vector<Product> getAllProducts() {
-        vector<Product> products;
-        inorder(root, products);
-        return products;
+    // Delete id only if allow(stored product) agrees, asked under the write
+    // lock so nothing changes in between; false (and no change) otherwise
+    template <typename Allow>
+    bool deleteIf(int id, Allow allow) {
+        lock_guard<mutex> guard(writeLock);
+        const Product* stored = current->search(id);
+        if (!stored || !allow(*stored))
+            return false;
+        publish(deleteNode(current->root, id));
+        return true;
     }
-};
 
-// --------------------- Linked List for Wishlist ---------------------
-struct ListNode {
-    Product product;
-    ListNode* next;
+    vector<Product> getAllProducts() const {
+        return snapshot().getAllProducts();
+    }
 
-    ListNode(Product p) : product(p), next(nullptr) {}
+    CatalogSnapshot snapshot() const {
+        return *atomic_load(&current);
+    }
 };
 
-class LinkedList {
+// Stock valuation of one consistent catalog version
+double inventoryValue(const CatalogSnapshot& catalog) {
+    double totalValue = 0;
+    catalog.forEach([&](const Product& product) {
+        totalValue += finalUnitPrice(product) * product.quantity;
+    });
+    return totalValue;
+}
+
+// --------------------- Packed Catalog ---------------------
+// Compact read-only encoding of a catalog version, used only to size the
+// catalog: no lookup, sale or report reads from it. The running terminal
+// keeps the pointer tree (sales need cheap copy-on-write edits); this is
+// built on demand by the memory estimate and --bench-memory to show what a
+// packed catalog would cost, and it round-trips every product to prove the
+// layout holds the data. Each product is one fixed 40-byte record in a flat
+// array sorted by id: money in integer paise, percents in basis points, the
+// date as yyyymmdd, and name/category as 32-bit indices into a pool where
+// every distinct string is stored once. No pointers, no per-product
+// allocations; lookups are a binary search over the array.
+class StringPool {
 private:
-    ListNode* head;
+    string characters;
+    vector<uint32_t> offsets{ 0 };  // String i is [offsets[i], offsets[i + 1])
+    unordered_map<string, uint32_t> indexOf;  // Only needed while building
+
 public:
-    LinkedList() : head(nullptr) {}
+    uint32_t intern(const string& text) {
+        auto found = indexOf.find(text);
+        if (found != indexOf.end())
+            return found->second;
+        uint32_t index = (uint32_t)(offsets.size() - 1);
+        characters += text;
+        offsets.push_back((uint32_t)characters.size());
+        indexOf.emplace(text, index);
+        return index;
+    }
 
-    void add(Product product) {
-        ListNode* newNode = new ListNode(product);
-        newNode->next = head;
-        head = newNode;
+    string_view get(uint32_t index) const {
+        return string_view(characters).substr(offsets[index], offsets[index + 1] - offsets[index]);
     }
 
-    void remove(int id) {
-        ListNode* temp = head;
-        ListNode* prev = nullptr;
-        while (temp && temp->product.id != id) {
-            prev = temp;
-            temp = temp->next;
-        }
-        if (!temp) return;  // not found
-        if (!prev)
-            head = temp->next;
-        else
-            prev->next = temp->next;
-        delete temp;
+    size_t size() const {
+        return offsets.size() - 1;
     }
 
-    vector<Product> getAll() {
-        vector<Product> products;
-        ListNode* temp = head;
-        while (temp) {
-            products.push_back(temp->product);
-            temp = temp->next;
-        }
-        return products;
+    // Drop the build-time hash map and trim spare capacity
+    void freeze() {
+        unordered_map<string, uint32_t>().swap(indexOf);
+        characters.shrink_to_fit();
+        offsets.shrink_to_fit();
     }
 
-    bool isEmpty() {
-        return (head == nullptr);
+    size_t bytes() const {
+        return characters.capacity() + offsets.capacity() * sizeof(uint32_t);
     }
 };
 
-// --------------------- Order History Stack ---------------------
-class OrderStack {
+struct PackedProduct {
+    int32_t id;
+    uint32_t name;          // StringPool index
+    uint32_t category;      // StringPool index
+    int32_t date;           // yyyymmdd (+ slashDate if written DD/MM/YYYY), or -(pool index + 1)
+    int64_t priceMinor;     // Paise
+    int32_t quantity;
+    int32_t discountBasisPoints;
+    int32_t taxBasisPoints;
+};
+static_assert(sizeof(PackedProduct) == 40, "packed product layout");
+
+class PackedCatalog {
 private:
-    stack<Product> orders;
-public:
-    void push(Product product) {
-        orders.push(product);
-    }
-    Product pop() {
-        Product product = orders.top();
-        orders.pop();
-        return product;
+    static const int32_t slashDate = 1 << 30;
+
+    vector<PackedProduct> records;
+    StringPool strings;
+    size_t roundedPrices = 0;
+
+    static bool packDate(const string& text, int32_t& packed) {
+        int key;
+        if (!dateKey(text, key))
+            return false;
+        packed = key + (text[2] == '/' ? slashDate : 0);
+        return true;
     }
-    bool isEmpty() {
-        return orders.empty();
+
+    string unpackDate(int32_t packed) const {
+        if (packed < 0)
+            return string(strings.get((uint32_t)(-packed - 1)));
+        bool slashes = packed >= slashDate;
+        packed -= slashes ? slashDate : 0;
+        char text[16];
+        if (slashes)
+            snprintf(text, sizeof(text), "%02d/%02d/%04d", packed % 100, packed / 100 % 100, packed / 10000);
+        else
+            snprintf(text, sizeof(text), "%04d-%02d-%02d", packed / 10000, packed / 100 % 100, packed % 100);
+        return text;
     }
-};
 
-// --------------------- Low Stock Alerts Queue ---------------------
-class LowStockQueue {
-private:
-    queue<Product> lowStockProducts;
 public:
-    void enqueue(Product product) {
-        lowStockProducts.push(product);
+    PackedCatalog() = default;
+
+    explicit PackedCatalog(const CatalogSnapshot& catalog) {
+        catalog.forEach([&](const Product& product) {
+            PackedProduct packed;
+            packed.id = product.id;
+            packed.name = strings.intern(product.name);
+            packed.category = strings.intern(product.category);
+            if (!packDate(product.Date, packed.date))
+                packed.date = -(int32_t)strings.intern(product.Date) - 1;
+            packed.priceMinor = llround(product.price * 100);
+            if (fabs(packed.priceMinor - product.price * 100) > 1e-6)
+                roundedPrices++;
+            packed.quantity = product.quantity;
+            packed.discountBasisPoints = (int32_t)lround(product.discount * 100);
+            packed.taxBasisPoints = (int32_t)lround(product.tax * 100);
+            records.push_back(packed);
+        });
+        records.shrink_to_fit();
+        strings.freeze();
     }
-    Product dequeue() {
-        Product product = lowStockProducts.front();
-        lowStockProducts.pop();
-        return product;
+
+    size_t size() const {
+        return records.size();
     }
-    bool isEmpty() {
-        return lowStockProducts.empty();
+
+    // Prices that had fractions of a paisa and were rounded when packed
+    size_t roundedPriceCount() const {
+        return roundedPrices;
     }
-};
 
-// --------------------- PointOfSaleSystem Class ---------------------
-class PointOfSaleSystem {
-private:
-    ProductTree productTree;
-    LinkedList wishlist;
-    OrderStack orderHistory;
-    LowStockQueue lowStockAlerts;
-    vector<pair<string, string>> admins;
+    size_t distinctStrings() const {
+        return strings.size();
+    }
 
-    // Updated file names for CSV files
-    const string productFile = "products.csv";
-    const string adminFile = "admins.csv";
-    const string ordersFile = "orders.csv";
-    const string wishlistFile = "wishlist.csv";
+    Product unpack(const PackedProduct& packed) const {
+        return Product(packed.id, string(strings.get(packed.name)), string(strings.get(packed.category)),
+            packed.priceMinor / 100.0, packed.quantity, unpackDate(packed.date),
+            packed.discountBasisPoints / 100.0, packed.taxBasisPoints / 100.0);
+    }
 
-    // Helper function to split a CSV line into tokens
-    vector<string> splitCSV(const string& line) {
-        vector<string> tokens;
-        stringstream ss(line);
-        string token;
-        while (getline(ss, token, ',')) {
-            tokens.push_back(token);
-        }
-        return tokens;
+    const PackedProduct* search(int id) const {
+        auto found = lower_bound(records.begin(), records.end(), id,
+            [](const PackedProduct& record, int key) { return record.id < key; });
+        return (found != records.end() && found->id == id) ? &*found : nullptr;
     }
 
-    // ----------------------- Products -----------------------
-    void loadProductsFromFile() {
-        ifstream file(productFile);
-        if (!file) {
-            cout << "\nNo existing product records found. Starting fresh.\n";
-            return;
-        }
-        string line;
-        while (getline(file, line)) {
-            if (line.empty()) continue;
-            vector<string> tokens = splitCSV(line);
-            if (tokens.size() != 8) {
-                cout << "Skipping malformed record: " << line << "\n";
-                continue;
-            }
-            try {
-                int id = stoi(tokens[0]);
-                string name = tokens[1];
-                string category = tokens[2];
-                double price = stod(tokens[3]);
-                int quantity = stoi(tokens[4]);
-                double discount = stod(tokens[5]);
-                double tax = stod(tokens[6]);
-                string Date = tokens[7];
-                productTree.insert(Product(id, name, category, price,
-                    quantity, Date, discount, tax));
-            }
-            catch (...) {
-                cout << "Error parsing record: " << line << "\n";
-            }
-        }
-        file.close();
+    size_t recordBytes() const {
+        return records.capacity() * sizeof(PackedProduct);
     }
 
-    void saveProductsToFile() {
-        ofstream file(productFile, ios::trunc);
-        if (!file) {
-            cout << "\nError saving products to file.\n";
-            return;
-        }
-        vector<Product> products = productTree.getAllProducts();
-        for (const auto& product : products) {
-            // CSV: id,name,category,price,quantity,discount,tax,Date
-            file << product.id << ","
-                << product.name << ","
-                << product.category << ","
-                << product.price << ","
-                << product.quantity << ","
-                << product.discount << ","
-                << product.tax << ","
-                << product.Date << "\n";
-        }
-        file.close();
+    size_t stringBytes() const {
+        return strings.bytes();
     }
 
-    // ----------------------- Admins -----------------------
-    void loadAdminsFromFile() {
-        ifstream file(adminFile);
-        if (!file) {
-            // If no admin file, create a default admin
-            admins.emplace_back("admin", "admin");
-            return;
-        }
-        string line;
-        while (getline(file, line)) {
-            if (line.empty()) continue;
-            vector<string> tokens = splitCSV(line);
-            if (tokens.size() != 2) {
-                cout << "Skipping malformed admin record: " << line << "\n";
-                continue;
-            }
-            admins.emplace_back(tokens[0], tokens[1]);
+    size_t totalBytes() const {
+        return sizeof(*this) + recordBytes() + stringBytes();
+    }
+};
+
+// Heap bytes one malloc of n bytes takes with glibc (8-byte header, 16-byte
+// granularity, 32-byte minimum chunk)
+size_t heapBlockBytes(size_t n) {
+    return max<size_t>(32, (n + 8 + 15) & ~(size_t)15);
+}
+
+// What the live tree costs: one make_shared block per node (control block
+// and node together) plus the heap buffer of every string too long for the
+// small-string buffer
+struct CatalogFootprint {
+    size_t products = 0;
+    size_t nodeBytes = 0;
+    size_t stringBytes = 0;
+
+    size_t totalBytes() const {
+        return nodeBytes + stringBytes;
+    }
+};
+
+CatalogFootprint measureCatalog(const CatalogSnapshot& catalog) {
+    // libstdc++ make_shared block: vtable pointer + two counts, then the node
+    const size_t blockBytes = heapBlockBytes(sizeof(void*) + 2 * sizeof(int) + sizeof(TreeNode));
+    CatalogFootprint footprint;
+    auto stringHeap = [](const string& text) {
+        return text.capacity() > 15 ? heapBlockBytes(text.capacity() + 1) : 0;
+    };
+    catalog.forEach([&](const Product& product) {
+        footprint.products++;
+        footprint.nodeBytes += blockBytes;
+        footprint.stringBytes += stringHeap(product.name) + stringHeap(product.category)
+            + stringHeap(product.Date);
+    });
+    return footprint;
+}
+
+void printMemoryReport(const CatalogSnapshot& catalog) {
+    auto start = chrono::steady_clock::now();
+    PackedCatalog packed(catalog);
+    double packMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    CatalogFootprint live = measureCatalog(catalog);
+    size_t skus = max<size_t>(1, live.products);
+    auto perSku = [&](size_t bytes) { return (double)bytes / skus; };
+
+    cout << "\nMemory Usage Estimate (" << live.products << " products)\n";
+    cout << "----------------------------------------\n";
+    cout << fixed << setprecision(1);
+    cout << left << setw(34) << "Live catalog (tree of Products)" << setw(14) << "Bytes" << "Per SKU\n";
+    cout << "  " << left << setw(32) << "nodes (Product + 2 shared_ptr)" << setw(14) << live.nodeBytes
+        << perSku(live.nodeBytes) << "\n";
+    cout << "  " << left << setw(32) << "heap strings" << setw(14) << live.stringBytes
+        << perSku(live.stringBytes) << "\n";
+    cout << "  " << left << setw(32) << "total" << setw(14) << live.totalBytes()
+        << perSku(live.totalBytes()) << "\n";
+    cout << left << setw(34) << "Packed catalog (estimate only)" << "\n";
+    cout << "  " << left << setw(32) << "records (40 bytes each)" << setw(14) << packed.recordBytes()
+        << perSku(packed.recordBytes()) << "\n";
+    cout << "  " << left << setw(32) << "string pool" << setw(14) << packed.stringBytes()
+        << perSku(packed.stringBytes()) << "\n";
+    cout << "  " << left << setw(32) << "total" << setw(14) << packed.totalBytes()
+        << perSku(packed.totalBytes()) << "\n";
+    if (packed.totalBytes() > 0)
+        cout << "Possible reduction: " << setprecision(1) << (double)live.totalBytes() / packed.totalBytes() << "x";
+    cout << "   Distinct strings: " << packed.distinctStrings()
+        << "   Packed in " << setprecision(2) << packMs << " ms\n";
+    if (packed.roundedPriceCount() > 0)
+        cout << "Note: " << packed.roundedPriceCount() << " prices have fractions of a paisa and are rounded when packed.\n";
+    cout << "The terminal keeps the tree; the packed figures show what this catalog would need in packed form.\n";
+}
+
+// --------------------- Sorted Catalog Views ---------------------
+// Catalog listings ordered by any combination of keys. Sorting works on an
+// array of 32-bit row numbers plus one column of numbers per key, never on
+// Product copies. Large arrays are sorted in chunks on several threads and
+// merged pairwise in parallel. Finished views are cached per key list until
+// the catalog publishes a new version.
+enum class SortKey { Id, Price, Quantity, Category, Expiry, FinalPrice };
+
+struct SortField {
+    SortKey key;
+    bool descending;
+};
+
+// Parse e.g. "category,-price" (a leading '-' sorts that key descending)
+bool parseSortFields(const string& text, vector<SortField>& fields) {
+    static const pair<const char*, SortKey> names[] = {
+        { "id", SortKey::Id }, { "price", SortKey::Price }, { "quantity", SortKey::Quantity },
+        { "category", SortKey::Category }, { "expiry", SortKey::Expiry }, { "final", SortKey::FinalPrice } };
+    fields.clear();
+    stringstream ss(toLower(text));
+    string token;
+    while (getline(ss, token, ',')) {
+        token.erase(remove(token.begin(), token.end(), ' '), token.end());
+        bool descending = !token.empty() && token[0] == '-';
+        if (descending)
+            token.erase(0, 1);
+        auto name = find_if(begin(names), end(names), [&](const auto& entry) { return token == entry.first; });
+        if (name == end(names))
+            return false;
+        fields.push_back({ name->second, descending });
+    }
+    return !fields.empty();
+}
+
+// Sort items with less, splitting the work over up to threads threads
+template <typename Less>
+void parallelSort(vector<uint32_t>& items, Less less, int threads) {
+    const size_t minimumChunk = 32768;
+    size_t chunks = min<size_t>(max(threads, 1), items.size() / minimumChunk);
+    if (chunks <= 1) {
+        sort(items.begin(), items.end(), less);
+        return;
+    }
+    vector<size_t> bounds;
+    for (size_t i = 0; i <= chunks; i++)
+        bounds.push_back(items.size() * i / chunks);
+    vector<thread> workers;
+    for (size_t i = 0; i < chunks; i++) {
+        workers.emplace_back([&, i] {
+            sort(items.begin() + bounds[i], items.begin() + bounds[i + 1], less);
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+
+    // Merge neighbouring runs in parallel, halving the run count each round
+    vector<uint32_t> scratch(items.size());
+    while (bounds.size() > 2) {
+        vector<size_t> merged{ 0 };
+        workers.clear();
+        for (size_t i = 0; i + 1 < bounds.size(); i += 2) {
+            size_t first = bounds[i], middle = bounds[i + 1];
+            size_t last = i + 2 < bounds.size() ? bounds[i + 2] : middle;
+            workers.emplace_back([&, first, middle, last] {
+                merge(items.begin() + first, items.begin() + middle, items.begin() + middle,
+                    items.begin() + last, scratch.begin() + first, less);
+            });
+            merged.push_back(last);
         }
-        file.close();
+        for (auto& worker : workers)
+            worker.join();
+        items.swap(scratch);
+        bounds.swap(merged);
     }
+}
 
-    void saveAdminsToFile() {
-        ofstream file(adminFile, ios::trunc);
-        if (!file) {
-            cout << "\nError saving admins to file.\n";
-            return;
+// One catalog version in a given order. Holding a view keeps that version alive.
+class SortedView {
+private:
+    CatalogSnapshot catalog;
+    vector<const Product*> rows;  // ID order
+    vector<uint32_t> order;       // Positions in rows, sorted
+
+public:
+    SortedView(const CatalogSnapshot& snapshot, const vector<SortField>& fields, int threads)
+        : catalog(snapshot) {
+        catalog.forEach([&](const Product& product) { rows.push_back(&product); });
+        order.resize(rows.size());
+        for (uint32_t i = 0; i < order.size(); i++)
+            order[i] = i;
+
+        // Categories are compared by their rank among the distinct names
+        unordered_map<string_view, double> categoryRank;
+        for (const auto& field : fields) {
+            if (field.key != SortKey::Category || !categoryRank.empty())
+                continue;
+            for (const Product* product : rows)
+                categoryRank.emplace(product->category, 0);
+            vector<string_view> names;
+            for (const auto& entry : categoryRank)
+                names.push_back(entry.first);
+            sort(names.begin(), names.end());
+            for (size_t i = 0; i < names.size(); i++)
+                categoryRank[names[i]] = (double)i;
         }
-        for (const auto& admin : admins) {
-            file << admin.first << "," << admin.second << "\n";
+        vector<vector<double>> columns(fields.size(), vector<double>(rows.size()));
+        for (size_t k = 0; k < fields.size(); k++) {
+            vector<double>& column = columns[k];
+            for (size_t i = 0; i < rows.size(); i++) {
+                const Product& product = *rows[i];
+                int date;
+                switch (fields[k].key) {
+                case SortKey::Id: column[i] = product.id; break;
+                case SortKey::Price: column[i] = product.price; break;
+                case SortKey::Quantity: column[i] = product.quantity; break;
+                case SortKey::Category: column[i] = categoryRank[product.category]; break;
+                case SortKey::Expiry:  // Unreadable dates sort last
+                    column[i] = dateKey(product.Date, date) ? date : numeric_limits<double>::infinity();
+                    break;
+                case SortKey::FinalPrice: column[i] = finalUnitPrice(product); break;
+                }
+            }
         }
-        file.close();
+        parallelSort(order, [&](uint32_t a, uint32_t b) {
+            for (size_t k = 0; k < fields.size(); k++) {
+                double x = columns[k][a], y = columns[k][b];
+                if (x != y)
+                    return fields[k].descending ? x > y : x < y;
+            }
+            return a < b;  // Ties stay in ID order
+        }, threads);
     }
 
-    // ----------------------- Wishlist -----------------------
-    void loadWishlistFromFile() {
-        ifstream file(wishlistFile);
-        if (!file) return; // No wishlist file yet
-        string line;
-        while (getline(file, line)) {
-            if (line.empty()) continue;
-            vector<string> tokens = splitCSV(line);
-            if (tokens.size() != 8) {
-                cout << "Skipping malformed wishlist record: " << line << "\n";
-                continue;
+    size_t size() const {
+        return order.size();
+    }
+
+    const Product& operator[](size_t i) const {
+        return *rows[order[i]];
+    }
+
+    unsigned long long version() const {
+        return catalog.getVersion();
+    }
+};
+
+class CatalogSorter {
+private:
+    mutex cacheLock;
+    unsigned long long cachedVersion = 0;
+    map<string, shared_ptr<const SortedView>> cache;  // Keyed by field list
+    int threads;
+
+public:
+    explicit CatalogSorter(int threads = (int)max(1u, thread::hardware_concurrency()))
+        : threads(threads) {
+    }
+
+    // A view of catalog in fields order; cached reports whether it was reused
+    shared_ptr<const SortedView> view(const CatalogSnapshot& catalog, const vector<SortField>& fields,
+        bool* cached = nullptr) {
+        string key;
+        for (const auto& field : fields)
+            key += to_string((int)field.key) + (field.descending ? "-" : "+");
+        {
+            lock_guard<mutex> guard(cacheLock);
+            if (catalog.getVersion() > cachedVersion) {
+                cache.clear();  // Catalog changed since these were sorted
+                cachedVersion = catalog.getVersion();
             }
-            try {
-                int id = stoi(tokens[0]);
-                string name = tokens[1];
-                string category = tokens[2];
-                double price = stod(tokens[3]);
-                int quantity = stoi(tokens[4]);
-                double discount = stod(tokens[5]);
-                double tax = stod(tokens[6]);
-                string Date = tokens[7];
-                wishlist.add(Product(id, name, category, price,
-                    quantity, Date, discount, tax));
+            auto found = cache.find(key);
+            if (found != cache.end() && cachedVersion == catalog.getVersion()) {
+                if (cached) *cached = true;
+                return found->second;
             }
-            catch (...) {
-                cout << "Error parsing wishlist record: " << line << "\n";
+        }
+        // Sorted outside the lock; two callers may race to build the same view
+        auto sorted = make_shared<const SortedView>(catalog, fields, threads);
+        lock_guard<mutex> guard(cacheLock);
+        if (cachedVersion == catalog.getVersion())
+            cache[key] = sorted;
+        if (cached) *cached = false;
+        return sorted;
+    }
+};
+
+// --------------------- Fuzzy Search ---------------------
+// Typo-tolerant name/category search. Every distinct word of the catalog is
+// stored once, folded to a rough sound-alike spelling ("light" and "lite"
+// both fold to "lite") and indexed by its trigrams; each word keeps a posting
+// list of the products that use it. A query word finds candidate words by
+// shared trigrams, scores them (exact, sound-alike, prefix, or within 1-2
+// typos by edit distance with transpositions) and adds the best score per
+// product into dense per-slot arrays, so ranking the top K never sorts the
+// whole catalog. Matches in the name count double those in the category.
+class SearchIndex {
+public:
+    struct Match {
+        int id;
+        int score;  // Points; see wordScore()
+    };
+
+    struct Stats {
+        size_t products = 0;
+        size_t words = 0;
+        size_t trigrams = 0;
+    };
+
+    // Lower-cased runs of letters and digits, each once
+    static vector<string> tokenize(const string& text) {
+        vector<string> tokens;
+        string token;
+        for (size_t i = 0; i <= text.size(); i++) {
+            if (i < text.size() && isalnum((unsigned char)text[i])) {
+                token += (char)tolower((unsigned char)text[i]);
+                continue;
             }
+            if (!token.empty() && find(tokens.begin(), tokens.end(), token) == tokens.end())
+                tokens.push_back(token);
+            token.clear();
         }
-        file.close();
+        return tokens;
     }
 
-    void saveWishlistToFile() {
-        ofstream file(wishlistFile, ios::trunc);
-        if (!file) {
-            cout << "\nError saving wishlist to file.\n";
-            return;
+    // Spelling-insensitive form: "ight" -> "ite", "ph" -> "f", "ck" -> "k",
+    // doubled letters collapsed
+    static string soundFold(const string& word) {
+        string folded;
+        for (size_t i = 0; i < word.size(); i++) {
+            char c = word[i];
+            if (word.compare(i, 4, "ight") == 0) {
+                folded += "ite";
+                i += 3;
+                continue;
+            }
+            if (word.compare(i, 2, "ph") == 0 || word.compare(i, 2, "ck") == 0) {
+                c = word[i] == 'p' ? 'f' : 'k';
+                i++;
+            }
+            if (folded.empty() || folded.back() != c)
+                folded += c;
         }
-        vector<Product> products = wishlist.getAll();
-        for (const auto& product : products) {
-            // CSV: id,name,category,price,quantity,discount,tax,Date
-            file << product.id << ","
-                << product.name << ","
-                << product.category << ","
-                << product.price << ","
-                << product.quantity << ","
-                << product.discount << ","
-                << product.tax << ","
-                << product.Date << "\n";
+        return folded;
+    }
+
+    // Edit distance counting a swap of neighbours as one edit, or limit + 1
+    // once it is certain to exceed limit
+    static int boundedDistance(const string& a, const string& b, int limit) {
+        if (abs((int)a.size() - (int)b.size()) > limit)
+            return limit + 1;
+        vector<int> before(b.size() + 1), previous(b.size() + 1), current(b.size() + 1);
+        for (size_t j = 0; j <= b.size(); j++)
+            previous[j] = (int)j;
+        for (size_t i = 1; i <= a.size(); i++) {
+            current[0] = (int)i;
+            int rowMinimum = current[0];
+            for (size_t j = 1; j <= b.size(); j++) {
+                int cost = a[i - 1] == b[j - 1] ? 0 : 1;
+                current[j] = min({ previous[j] + 1, current[j - 1] + 1, previous[j - 1] + cost });
+                if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1])
+                    current[j] = min(current[j], before[j - 2] + 1);
+                rowMinimum = min(rowMinimum, current[j]);
+            }
+            if (rowMinimum > limit)
+                return limit + 1;
+            before.swap(previous);
+            previous.swap(current);
         }
-        file.close();
+        return min(previous[b.size()], limit + 1);
     }
 
-    // ----------------------- Other Functions -----------------------
-    void addToWishlist() {
-        int id;
-        cout << "\nEnter Product ID to add to wishlist: ";
-        while (!getValidatedInteger(id)) {
-            cout << "Invalid input ID: ";
+    // Typos tolerated in a query word of the given length
+    static int typoLimit(size_t length) {
+        return length <= 2 ? 0 : length <= 5 ? 1 : 2;
+    }
+
+    // 10 exact, 9 sound-alike, 8 prefix (3+ letters), 6 one typo, 4 two, 0 no match
+    static int wordScore(const string& query, const string& queryFolded,
+        const string& word, const string& wordFolded) {
+        if (query == word)
+            return 10;
+        if (queryFolded == wordFolded)
+            return 9;
+        if (query.size() >= 3 && word.compare(0, query.size(), query) == 0)
+            return 8;
+        int limit = typoLimit(query.size());
+        int distance = boundedDistance(queryFolded, wordFolded, limit);
+        return distance <= limit ? 10 - 2 * distance - 2 : 0;
+    }
+
+    // Reference scoring of one product without the index (used to check it)
+    static int scoreProduct(const vector<string>& queryWords, const Product& product) {
+        vector<string> nameWords = tokenize(product.name);
+        vector<string> categoryWords = tokenize(product.category);
+        int total = 0;
+        for (const auto& query : queryWords) {
+            string queryFolded = soundFold(query);
+            int best = 0;
+            for (const auto& word : nameWords)
+                best = max(best, 2 * wordScore(query, queryFolded, word, soundFold(word)));
+            for (const auto& word : categoryWords)
+                best = max(best, wordScore(query, queryFolded, word, soundFold(word)));
+            total += best;
         }
-        Product* product = productTree.search(id);
-        if (product) {
-            wishlist.add(*product);
-            cout << "\nProduct added to wishlist successfully.\n";
-            saveWishlistToFile();
+        return total;
+    }
+
+private:
+    mutable mutex indexLock;
+
+    // Vocabulary
+    vector<string> words;
+    vector<string> foldedWords;
+    vector<vector<uint32_t>> postings;  // Per word: slot * 2 + 1 if in the name
+    unordered_map<string, uint32_t> wordIds;
+    unordered_map<uint32_t, vector<uint32_t>> trigramWords;  // Packed trigram -> word ids
+
+    // Products by slot
+    vector<int> slotIds;
+    vector<uint32_t> freeSlots;
+    unordered_map<int, uint32_t> slotOf;
+
+    // Query scratch, reused between searches. A slot's fields sit together
+    // so each posting visited touches one cache line.
+    struct SlotScratch {
+        uint32_t queryStamp = 0;  // Score belongs to the current query
+        uint32_t wordStamp = 0;   // Best belongs to the current query word
+        int score = 0;
+        int best = 0;
+    };
+    vector<SlotScratch> scratch;
+    vector<uint32_t> candidateStamp, candidateHits;
+    uint32_t queryCounter = 0, queryWordCounter = 0, candidateCounter = 0;
+
+    template <typename Visit>
+    static void forEachTrigram(const string& folded, Visit visit) {
+        string padded = "^" + folded + "$";
+        for (size_t i = 0; i + 3 <= padded.size(); i++)
+            visit((uint32_t)(unsigned char)padded[i] << 16 | (uint32_t)(unsigned char)padded[i + 1] << 8
+                | (unsigned char)padded[i + 2]);
+    }
+
+    uint32_t wordId(const string& word) {
+        auto found = wordIds.find(word);
+        if (found != wordIds.end())
+            return found->second;
+        uint32_t id = (uint32_t)words.size();
+        words.push_back(word);
+        foldedWords.push_back(soundFold(word));
+        postings.emplace_back();
+        wordIds.emplace(word, id);
+        forEachTrigram(foldedWords.back(), [&](uint32_t trigram) {
+            vector<uint32_t>& list = trigramWords[trigram];
+            if (list.empty() || list.back() != id)
+                list.push_back(id);
+        });
+        candidateStamp.push_back(0);
+        candidateHits.push_back(0);
+        return id;
+    }
+
+    // Words of a product with their posting flag; name words win over category
+    static vector<pair<string, uint32_t>> productWords(const Product& product) {
+        vector<pair<string, uint32_t>> result;
+        for (auto& word : tokenize(product.name))
+            result.emplace_back(move(word), 1);
+        for (auto& word : tokenize(product.category)) {
+            if (find_if(result.begin(), result.end(), [&](const auto& entry) { return entry.first == word; })
+                == result.end())
+                result.emplace_back(move(word), 0);
         }
-        else {
-            cout << "\nProduct not found.\n";
+        return result;
+    }
+
+    // Advance a stamp counter, clearing its marks on wrap-around
+    template <typename Marks, typename Clear>
+    static uint32_t nextStamp(uint32_t& counter, Marks& marks, Clear clear) {
+        if (++counter == 0) {
+            for (auto& mark : marks)
+                clear(mark);
+            counter = 1;
         }
+        return counter;
     }
 
-    void viewWishlist() {
-        vector<Product> products = wishlist.getAll();
-        if (products.empty()) {
-            cout << "\nYour wishlist is empty.\n";
+    void addLocked(const Product& product) {
+        if (slotOf.count(product.id))
             return;
+        uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+            slotIds[slot] = product.id;
         }
-        cout << "\nYour Wishlist:\n";
-        cout << left << setw(10) << "ID" << setw(20) << "Name"
-            << setw(20) << "Category" << setw(10) << "Price"
-            << setw(10) << "Qty" << setw(10) << "Discount"
-            << setw(10) << "Tax" << setw(15) << "Expiry Date" << "\n";
-        cout << string(105, '-') << "\n";
-        for (const auto& product : products) {
-            cout << left << setw(10) << product.id
-                << setw(20) << product.name
-                << setw(20) << product.category
-                << setw(10) << fixed << setprecision(2) << product.price
-                << setw(10) << product.quantity
-                << setw(10) << product.discount << "%"
-                << setw(10) << product.tax << "%"
-                << setw(15) << product.Date << "\n";
+        else {
+            slot = (uint32_t)slotIds.size();
+            slotIds.push_back(product.id);
+            scratch.emplace_back();
         }
+        slotOf.emplace(product.id, slot);
+        for (const auto& word : productWords(product))
+            postings[wordId(word.first)].push_back(slot * 2 + word.second);
     }
 
-    // Customer places order (cart functionality removed)
-    void checkout() {
-        int id;
-        int orderQuantity;
-        cout << "\nEnter Product ID to order: ";
-        while (!getValidatedInteger(id)) {
-            cout << "Invalid input ID: ";
+    void removeLocked(const Product& product) {
+        auto found = slotOf.find(product.id);
+        if (found == slotOf.end())
+            return;
+        uint32_t slot = found->second;
+        for (const auto& word : productWords(product)) {
+            auto id = wordIds.find(word.first);
+            if (id == wordIds.end())
+                continue;
+            // Posting order does not matter, so swap with the last and pop.
+            // Words left with no products stay in the vocabulary.
+            vector<uint32_t>& list = postings[id->second];
+            auto posting = find(list.begin(), list.end(), slot * 2 + word.second);
+            if (posting != list.end()) {
+                *posting = list.back();
+                list.pop_back();
+            }
         }
-        Product* product = productTree.search(id);
-        if (product) {
-            cout << "Enter Quantity to order: ";
-            while (!getValidatedInteger(orderQuantity)) {
-                cout << "Invalid input Quantity: ";
+        slotOf.erase(found);
+        freeSlots.push_back(slot);
+    }
+
+public:
+    void add(const Product& product) {
+        lock_guard<mutex> guard(indexLock);
+        addLocked(product);
+    }
+
+    // Needs the product as it was indexed, to find its words
+    void remove(const Product& product) {
+        lock_guard<mutex> guard(indexLock);
+        removeLocked(product);
+    }
+
+    void update(const Product& before, const Product& after) {
+        lock_guard<mutex> guard(indexLock);
+        removeLocked(before);
+        addLocked(after);
+    }
+
+    void rebuild(const CatalogSnapshot& catalog) {
+        lock_guard<mutex> guard(indexLock);
+        words.clear();
+        foldedWords.clear();
+        postings.clear();
+        wordIds.clear();
+        trigramWords.clear();
+        slotIds.clear();
+        freeSlots.clear();
+        slotOf.clear();
+        scratch.clear();
+        candidateStamp.clear();
+        candidateHits.clear();
+        catalog.forEach([&](const Product& product) { addLocked(product); });
+    }
+
+    // The limit best products for query, highest score first, ties by id
+    vector<Match> search(const string& query, size_t limit) {
+        lock_guard<mutex> guard(indexLock);
+        vector<uint32_t> touched;
+        uint32_t queryStamp = nextStamp(queryCounter, scratch, [](SlotScratch& slot) { slot.queryStamp = 0; });
+        for (const auto& queryWord : tokenize(query)) {
+            string queryFolded = soundFold(queryWord);
+            int typos = typoLimit(queryWord.size());
+
+            // Candidate words share at least this many trigrams (one edit or
+            // swap breaks at most four), and always at least one
+            int trigramCount = 0;
+            vector<uint32_t> candidates;
+            uint32_t candidateMark = nextStamp(candidateCounter, candidateStamp, [](uint32_t& mark) { mark = 0; });
+            forEachTrigram(queryFolded, [&](uint32_t trigram) {
+                trigramCount++;
+                auto found = trigramWords.find(trigram);
+                if (found == trigramWords.end())
+                    return;
+                for (uint32_t id : found->second) {
+                    if (candidateStamp[id] != candidateMark) {
+                        candidateStamp[id] = candidateMark;
+                        candidateHits[id] = 0;
+                        candidates.push_back(id);
+                    }
+                    candidateHits[id]++;
+                }
+            });
+            int required = max(1, trigramCount - 4 * typos);
+
+            uint32_t wordMark = nextStamp(queryWordCounter, scratch, [](SlotScratch& slot) { slot.wordStamp = 0; });
+            for (uint32_t id : candidates) {
+                if ((int)candidateHits[id] < required || postings[id].empty())
+                    continue;
+                int points = wordScore(queryWord, queryFolded, words[id], foldedWords[id]);
+                if (points == 0)
+                    continue;
+                for (uint32_t posting : postings[id]) {
+                    SlotScratch& slot = scratch[posting >> 1];
+                    int gained = (posting & 1) ? 2 * points : points;
+                    if (slot.queryStamp != queryStamp) {
+                        slot.queryStamp = queryStamp;
+                        slot.score = 0;
+                        touched.push_back(posting >> 1);
+                    }
+                    // Only the best matching word of a product counts per query word
+                    if (slot.wordStamp != wordMark) {
+                        slot.wordStamp = wordMark;
+                        slot.best = gained;
+                        slot.score += gained;
+                    }
+                    else if (gained > slot.best) {
+                        slot.score += gained - slot.best;
+                        slot.best = gained;
+                    }
+                }
             }
-            if (orderQuantity > product->quantity) {
-                cout << "\nNot enough stock available. Order quantity exceeds available stock.\n";
+        }
+
+        auto better = [](const Match& a, const Match& b) {
+            return a.score != b.score ? a.score > b.score : a.id < b.id;
+        };
+        vector<Match> top;  // Heap with the worst kept match on top
+        for (uint32_t slot : touched) {
+            Match match{ slotIds[slot], scratch[slot].score };
+            if (top.size() < limit) {
+                top.push_back(match);
+                push_heap(top.begin(), top.end(), better);
             }
-            else {
-                product->quantity -= orderQuantity;
-                double discountedPrice = product->price * (1 - product->discount / 100);
-                double taxedPrice = discountedPrice * (1 + product->tax / 100);
-                double totalPrice = taxedPrice * orderQuantity;
-                cout << "\nOrder placed successfully.\n";
-                cout << "Total Bill: Rs." << fixed << setprecision(2) << totalPrice << "\n";
-                // Save order info
-                ofstream orderFile(ordersFile, ios::app);
-                orderFile << "Product ID: " << product->id << "\n";
-                orderFile << "Product Name: " << product->name << "\n";
-                orderFile << "Quantity Ordered: " << orderQuantity << "\n";
-                orderFile << "Total Price: Rs." << fixed << setprecision(2) << totalPrice << "\n\n";
-                orderFile.close();
-                saveProductsToFile();
+            else if (limit > 0 && better(match, top.front())) {
+                pop_heap(top.begin(), top.end(), better);
+                top.back() = match;
+                push_heap(top.begin(), top.end(), better);
             }
         }
-        else {
-            cout << "\nProduct not found.\n";
+        sort_heap(top.begin(), top.end(), better);
+        return top;
+    }
+
+    Stats stats() const {
+        lock_guard<mutex> guard(indexLock);
+        Stats result;
+        result.products = slotOf.size();
+        result.words = words.size();
+        result.trigrams = trigramWords.size();
+        return result;
+    }
+};
+
+// --------------------- Hot Product Cache ---------------------
+// Small cache of final unit prices keyed by product id. A price quote for a
+// hot item is answered from it without searching the catalog tree at all;
+// sales still walk the tree to take stock, and only skip the pricing math.
+// Each set of four ways fills exactly one cache
+// line. Readers never lock: a per-set sequence number (odd while a writer is
+// inside) tells them to treat a torn read as a miss. Eviction is CLOCK within
+// the set: a hit sets the way's reference bit and the hand skips referenced
+// ways once, clearing the bit as it passes.
+class HotPriceCache {
+private:
+    static const int ways = 4;
+    static const int setCount = 4096;  // 16384 entries, 256 KB (fits in L2)
+    static constexpr int32_t emptyId = numeric_limits<int32_t>::min();
+
+    struct alignas(64) CacheSet {
+        atomic<uint32_t> sequence{ 0 };
+        atomic<uint8_t> referenced{ 0 };  // One bit per way
+        uint8_t hand = 0;                 // Only touched under the set lock
+        atomic<int32_t> ids[ways];
+        atomic<double> unitPrices[ways];
+
+        CacheSet() {
+            for (int w = 0; w < ways; w++) {
+                ids[w].store(emptyId, memory_order_relaxed);
+                unitPrices[w].store(0, memory_order_relaxed);
+            }
         }
+    };
+    static_assert(sizeof(CacheSet) == 64, "one set per cache line");
+
+    unique_ptr<CacheSet[]> sets{ new CacheSet[setCount] };
+    // Bumped by every invalidation; a miss that read the catalog before the
+    // bump must not store what it computed
+    atomic<uint64_t> generationCounter{ 0 };
+    alignas(64) atomic<uint64_t> hitCount{ 0 };
+    atomic<uint64_t> missCount{ 0 };
+
+    CacheSet& setFor(int id) {
+        return sets[((uint32_t)id * 2654435761u) >> 20];
     }
 
-    void viewTotalInventoryValue() {
-        double totalValue = 0;
-        vector<Product> products = productTree.getAllProducts();
-        for (const auto& product : products) {
-            double discountedPrice = product.price * (1 - product.discount / 100);
-            double taxedPrice = discountedPrice * (1 + product.tax / 100);
-            totalValue += taxedPrice * product.quantity;
+    static void lockSet(CacheSet& set) {
+        uint32_t sequence = set.sequence.load(memory_order_relaxed);
+        while ((sequence & 1) || !set.sequence.compare_exchange_weak(sequence, sequence + 1,
+            memory_order_acquire, memory_order_relaxed)) {
+            this_thread::yield();
+            sequence = set.sequence.load(memory_order_relaxed);
         }
-        cout << "\nTotal Inventory Value: Rs." << fixed << setprecision(2) << totalValue << "\n";
+        atomic_thread_fence(memory_order_release);  // Odd sequence is seen before the edits
     }
 
-    void sortProductsById() {
-        vector<Product> products = productTree.getAllProducts();
-        sort(products.begin(), products.end(), [](const Product& a, const Product& b) {
-            return a.id < b.id;
-            });
-        cout << "\nProducts sorted by ID successfully.\n";
+    static void unlockSet(CacheSet& set) {
+        set.sequence.fetch_add(1, memory_order_release);
     }
 
-    void generateReport() {
-        ofstream report("report.csv");
-        if (!report) {
-            cout << "\nError generating report.\n";
-            return;
-        }
-        // Write header row in CSV format
-        report << "ID,Name,Category,Price,Quantity,Discount,Tax,Expiry Date\n";
-        vector<Product> products = productTree.getAllProducts();
-        for (const auto& product : products) {
-            report << product.id << ","
-                << product.name << ","
-                << product.category << ","
-                << fixed << setprecision(2) << product.price << ","
-                << product.quantity << ","
-                << product.discount << ","
-                << product.tax << ","
-                << product.Date << "\n";
+public:
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+
+        double hitRatio() const {
+            return hits + misses ? (double)hits / (hits + misses) : 0.0;
         }
-        cout << "\nReport generated successfully in 'report.csv'.\n";
+    };
+
+    // Read before looking the product up; pass to store() with the result
+    uint64_t generation() const {
+        return generationCounter.load();
     }
 
-    void searchProduct() {
-        int id;
-        cout << "\nEnter product ID to search: ";
-        while (!getValidatedInteger(id)) {
-            cout << "Invalid input ID: ";
-        }
-        Product* product = productTree.search(id);
-        if (product) {
-            cout << "\nProduct Found:\n";
-            cout << "ID: " << product->id << "\n";
-            cout << "Name: " << product->name << "\n";
-            cout << "Category: " << product->category << "\n";
-            cout << "Price: " << product->price << "\n";
-            cout << "Quantity: " << product->quantity << "\n";
-            cout << "Discount: " << product->discount << "%\n";
-            cout << "Tax: " << product->tax << "%\n";
-            cout << "Date: " << product->Date << "\n";
-        }
-        else {
-            cout << "\nProduct not found.\n";
+    bool lookup(int id, double& unitPrice) {
+        CacheSet& set = setFor(id);
+        uint32_t before = set.sequence.load(memory_order_acquire);
+        if (!(before & 1)) {
+            for (int w = 0; w < ways; w++) {
+                if (set.ids[w].load(memory_order_relaxed) != id)
+                    continue;
+                double price = set.unitPrices[w].load(memory_order_relaxed);
+                atomic_thread_fence(memory_order_acquire);
+                if (set.sequence.load(memory_order_relaxed) != before)
+                    break;
+                uint8_t bit = (uint8_t)(1u << w);
+                if (!(set.referenced.load(memory_order_relaxed) & bit))
+                    set.referenced.fetch_or(bit, memory_order_relaxed);
+                unitPrice = price;
+                hitCount.fetch_add(1, memory_order_relaxed);
+                return true;
+            }
         }
+        missCount.fetch_add(1, memory_order_relaxed);
+        return false;
     }
 
-    void deleteProduct() {
-        int id;
-        cout << "\nEnter product ID to delete: ";
-        while (!getValidatedInteger(id)) {
-            cout << "Invalid input ID. Please try again: ";
+    void store(int id, double unitPrice, uint64_t generationSeen) {
+        CacheSet& set = setFor(id);
+        lockSet(set);
+        if (generationCounter.load() == generationSeen) {
+            int way = -1;
+            for (int w = 0; w < ways && way < 0; w++) {
+                if (set.ids[w].load(memory_order_relaxed) == id)
+                    way = w;
+            }
+            for (int w = 0; w < ways && way < 0; w++) {
+                if (set.ids[w].load(memory_order_relaxed) == emptyId)
+                    way = w;
+            }
+            while (way < 0) {
+                uint8_t bit = (uint8_t)(1u << set.hand);
+                if (set.referenced.load(memory_order_relaxed) & bit)
+                    set.referenced.fetch_and((uint8_t)~bit, memory_order_relaxed);
+                else
+                    way = set.hand;
+                set.hand = (uint8_t)((set.hand + 1) % ways);
+            }
+            set.ids[way].store(id, memory_order_relaxed);
+            set.unitPrices[way].store(unitPrice, memory_order_relaxed);
         }
+        unlockSet(set);
+    }
 
-        Product* product = productTree.search(id);
-        if (product) {
-            productTree.deleteProduct(id); // Correctly call the delete function
-            cout << "\nProduct deleted successfully.\n";
-            saveProductsToFile(); // Update the CSV file after deletion
-        }
-        else {
-            cout << "\nProduct not found.\n";
+    // Call after the catalog change has been published
+    void invalidate(int id) {
+        generationCounter.fetch_add(1);
+        CacheSet& set = setFor(id);
+        lockSet(set);
+        for (int w = 0; w < ways; w++) {
+            if (set.ids[w].load(memory_order_relaxed) == id)
+                set.ids[w].store(emptyId, memory_order_relaxed);
         }
+        unlockSet(set);
     }
 
-    // Modified modifyProduct function with an option to add additional quantity.
-    void modifyProduct() {
-        int id;
-        cout << "\nEnter Product ID to modify: ";
-        while (!getValidatedInteger(id)) {
-            cout << "Invalid input for Product ID. Please try again: ";
+    void invalidateAll() {
+        generationCounter.fetch_add(1);
+        for (int s = 0; s < setCount; s++) {
+            lockSet(sets[s]);
+            for (int w = 0; w < ways; w++)
+                sets[s].ids[w].store(emptyId, memory_order_relaxed);
+            unlockSet(sets[s]);
         }
+    }
 
-        Product* product = productTree.search(id);
-        if (product) {
-            cout << "\nEnter new details for the product:\n";
+    Stats stats() const {
+        return { hitCount.load(memory_order_relaxed), missCount.load(memory_order_relaxed) };
+    }
+};
 
-            // Get and validate the new name
-            string newName;
-            cout << "Name: ";
-            while (!getValidatedString(newName, true)) {
-                cout << "Invalid input for Name. Please try again: ";
-            }
-            product->name = newName;
-
-            // Get and validate the new category
-            string newCategory;
-            cout << "Category: ";
-            while (!getValidatedString(newCategory, true)) {
-                cout << "Invalid input for Category. Please try again: ";
-            }
-            product->category = newCategory;
+// --------------------- Promotions ---------------------
+// One promotion rule, as stored in promotions.csv. Scope "product" targets a
+// product id and "category" a category name. Type "percent" takes Percent
+// Off once the order reaches Min Quantity (1 for a plain sale, more for a
+// quantity tier); type "bxgy" gives Get Free units for every Buy units
+// bought. Starts/Ends are "YYYY-MM-DD HH:MM" local time; empty means open.
+// Promotions do not stack: an order gets whichever applicable rule is
+// cheapest for the customer.
+class Promotion {
+public:
+    int id = 0;
+    string scope;
+    string target;
+    string type;
+    double percentOff = 0;
+    int minQuantity = 1;
+    int buy = 0;
+    int getFree = 0;
+    string starts;
+    string ends;
+};
 
-            // Get and validate the new price
-            double newPrice;
-            cout << "Price: ";
-            while (!getValidatedDouble(newPrice)) {
-                cout << "Invalid input for Price. Please try again: ";
-            }
-            product->price = newPrice;
+constexpr auto promotionColumns = make_tuple(
+    Column<&Promotion::id>{ "ID" },
+    Column<&Promotion::scope>{ "Scope" },
+    Column<&Promotion::target>{ "Target" },
+    Column<&Promotion::type>{ "Type" },
+    Column<&Promotion::percentOff>{ "Percent Off" },
+    Column<&Promotion::minQuantity>{ "Min Quantity" },
+    Column<&Promotion::buy>{ "Buy" },
+    Column<&Promotion::getFree>{ "Get Free" },
+    Column<&Promotion::starts>{ "Starts" },
+    Column<&Promotion::ends>{ "Ends" });
 
-            // Show current quantity and get additional quantity to add
-            cout << "Current Quantity: " << product->quantity << "\n";
-            int addQty;
-            cout << "Enter quantity to add (enter 0 if no change): ";
-            while (!getValidatedInteger(addQty)) {
-                cout << "Invalid input for Quantity. Please try again: ";
-            }
-            product->quantity += addQty;
+// "YYYY-MM-DD HH:MM" in local time
+bool parseLocalMinute(const string& text, time_t& when) {
+    int hour, minute;
+    if (text.size() != 16 || text[10] != ' ' || text[13] != ':' || !isValidDate(text.substr(0, 10))
+        || !isdigit((unsigned char)text[11]) || !isdigit((unsigned char)text[12])
+        || !isdigit((unsigned char)text[14]) || !isdigit((unsigned char)text[15]))
+        return false;
+    hour = stoi(text.substr(11, 2));
+    minute = stoi(text.substr(14, 2));
+    if (hour > 23 || minute > 59)
+        return false;
+    tm local{};
+    local.tm_year = stoi(text.substr(0, 4)) - 1900;
+    local.tm_mon = stoi(text.substr(5, 2)) - 1;
+    local.tm_mday = stoi(text.substr(8, 2));
+    local.tm_hour = hour;
+    local.tm_min = minute;
+    local.tm_isdst = -1;
+    when = mktime(&local);
+    return when != (time_t)-1;
+}
 
-            // Get and validate the new discount
-            double newDiscount;
-            cout << "Enter Discount (%): ";
-            while (!getValidatedDouble(newDiscount)) {
-                cout << "Invalid input for Discount. Please try again: ";
-            }
-            product->discount = newDiscount;
+// A promotion checked and converted for pricing
+struct PromotionRule {
+    int id;
+    bool byCategory;
+    int productId;
+    string category;
+    bool bundle;         // Buy X get Y; otherwise percent off
+    double percentOff;
+    int minQuantity;
+    int buy;
+    int getFree;
+    time_t starts;
+    time_t ends;
 
-            // Get and validate the new tax
-            double newTax;
-            cout << "Enter Tax (%): ";
-            while (!getValidatedDouble(newTax)) {
-                cout << "Invalid input for Tax. Please try again: ";
-            }
-            product->tax = newTax;
+    bool activeAt(time_t now) const {
+        return starts <= now && now < ends;
+    }
 
-            // Get and validate the new date
-            string newDate;
-            cout << "Date (YYYY-MM-DD): ";
-            // Ensure any leftover newline is consumed
-            cin.ignore(numeric_limits<streamsize>::max(), '\n');
-            while (true) {
-                getline(cin, newDate);
-                if (isValidDate(newDate)) {   // Assumes isValidDate() is defined elsewhere.
-                    product->Date = newDate;
-                    break;
-                }
-                else {
-                    cout << "Invalid date format. Please try again (YYYY-MM-DD): ";
-                }
-            }
+    // Total for quantity units at unitPrice under this rule alone
+    double orderTotal(double unitPrice, int quantity) const {
+        if (bundle)
+            return unitPrice * (quantity - quantity / (buy + getFree) * getFree);
+        if (quantity < minQuantity)
+            return unitPrice * quantity;
+        return unitPrice * quantity * (1 - percentOff / 100);
+    }
+};
 
-            cout << "\nProduct modified successfully.\n";
+// Check a promotion record; false with a reason if it cannot be used
+bool compilePromotionRule(const Promotion& promotion, PromotionRule& rule, string& error) {
+    rule = PromotionRule{};
+    rule.id = promotion.id;
+    if (promotion.scope == "product") {
+        if (!parseField(promotion.target, rule.productId)) {
+            error = "product target must be a product ID";
+            return false;
         }
-        else {
-            cout << "\nProduct not found.\n";
+    }
+    else if (promotion.scope == "category") {
+        rule.byCategory = true;
+        rule.category = promotion.target;
+    }
+    else {
+        error = "scope must be product or category";
+        return false;
+    }
+    if (promotion.type == "percent") {
+        if (!(promotion.percentOff > 0 && promotion.percentOff <= 100) || promotion.minQuantity < 1) {
+            error = "percent off must be in (0, 100] and min quantity at least 1";
+            return false;
         }
+        rule.percentOff = promotion.percentOff;
+        rule.minQuantity = promotion.minQuantity;
     }
-
-    void addProduct() {
-        int id;
-        string name, category, Date;
-        double price, discount, tax;
-        int quantity;
-
-        cout << "\nEnter Product ID: ";
-        while (!getValidatedInteger(id)) {
-            cout << "Invalid input for product ID: ";
+    else if (promotion.type == "bxgy") {
+        if (promotion.buy < 1 || promotion.getFree < 1) {
+            error = "buy and get free must both be at least 1";
+            return false;
         }
+        rule.bundle = true;
+        rule.buy = promotion.buy;
+        rule.getFree = promotion.getFree;
+    }
+    else {
+        error = "type must be percent or bxgy";
+        return false;
+    }
+    rule.starts = numeric_limits<time_t>::min();
+    rule.ends = numeric_limits<time_t>::max();
+    if ((!promotion.starts.empty() && !parseLocalMinute(promotion.starts, rule.starts))
+        || (!promotion.ends.empty() && !parseLocalMinute(promotion.ends, rule.ends))) {
+        error = "times must be YYYY-MM-DD HH:MM";
+        return false;
+    }
+    if (rule.ends <= rule.starts) {
+        error = "promotion ends before it starts";
+        return false;
+    }
+    return true;
+}
 
-        cout << "Enter Product Name: ";
-        // Use getline to get the full name (allows spaces)
-        while (!getValidatedString(name, true)) {
-            cout << "Invalid input for name: ";
-        }
+// The rules active in one time window, folded into a plan per product id and
+// per category. Percent tiers are kept sorted by min quantity with the ones
+// beaten by a smaller tier dropped, so a plan holds a handful of entries no
+// matter how many rules were loaded. Pricing an order is two hash lookups.
+class CompiledPromotions {
+public:
+    struct PricePlan {
+        vector<pair<int, double>> tiers;    // (min quantity, percent off)
+        vector<pair<int, int>> bundles;     // (buy, get free)
 
-        cout << "Enter Product Category: ";
-        while (!getValidatedString(category, true)) {
-            cout << "Invalid input for category: ";
+        void applyTo(double unitPrice, int quantity, double& best) const {
+            // Last tier the quantity reaches has the largest discount
+            auto tier = upper_bound(tiers.begin(), tiers.end(), make_pair(quantity, 101.0));
+            if (tier != tiers.begin())
+                best = min(best, unitPrice * quantity * (1 - prev(tier)->second / 100));
+            for (const auto& bundle : bundles)
+                best = min(best, unitPrice * (quantity - quantity / (bundle.first + bundle.second) * bundle.second));
         }
+    };
 
-        cout << "Enter Product Price: ";
-        while (!getValidatedDouble(price)) {
-            cout << "Invalid input for Price: ";
-        }
+    unordered_map<int, PricePlan> byProduct;
+    unordered_map<string, PricePlan> byCategory;
+    time_t validFrom = numeric_limits<time_t>::min();  // Plan holds for [validFrom, validUntil)
+    time_t validUntil = numeric_limits<time_t>::max();
+    size_t activeRules = 0;
 
-        cout << "Enter Product Quantity: ";
-        while (!getValidatedInteger(quantity)) {
-            cout << "Invalid input for Quantity: ";
-        }
+    CompiledPromotions() = default;
 
-        cout << "Enter Discount (%): ";
-        while (!getValidatedDouble(discount)) {
-            cout << "Invalid input for Discount: ";
+    CompiledPromotions(const vector<PromotionRule>& rules, time_t now) {
+        for (const auto& rule : rules) {
+            for (time_t boundary : { rule.starts, rule.ends }) {
+                if (boundary <= now)
+                    validFrom = max(validFrom, boundary);
+                else
+                    validUntil = min(validUntil, boundary);
+            }
+            if (!rule.activeAt(now))
+                continue;
+            activeRules++;
+            PricePlan& plan = rule.byCategory ? byCategory[rule.category] : byProduct[rule.productId];
+            if (rule.bundle)
+                plan.bundles.emplace_back(rule.buy, rule.getFree);
+            else
+                plan.tiers.emplace_back(rule.minQuantity, rule.percentOff);
         }
+        auto prune = [](PricePlan& plan) {
+            sort(plan.tiers.begin(), plan.tiers.end());
+            vector<pair<int, double>> kept;
+            for (const auto& tier : plan.tiers) {
+                while (!kept.empty() && kept.back().first == tier.first)
+                    kept.pop_back();  // Same threshold, sorted by percent: keep the larger
+                if (kept.empty() || tier.second > kept.back().second)
+                    kept.push_back(tier);
+            }
+            plan.tiers.swap(kept);
+            sort(plan.bundles.begin(), plan.bundles.end());
+            plan.bundles.erase(unique(plan.bundles.begin(), plan.bundles.end()), plan.bundles.end());
+        };
+        for (auto& entry : byProduct)
+            prune(entry.second);
+        for (auto& entry : byCategory)
+            prune(entry.second);
+    }
 
-        cout << "Enter Tax (%): ";
-        while (!getValidatedDouble(tax)) {
-            cout << "Invalid input for Tax: ";
+    double orderTotal(const Product& product, double unitPrice, int quantity) const {
+        double best = unitPrice * quantity;
+        auto productPlan = byProduct.find(product.id);
+        if (productPlan != byProduct.end())
+            productPlan->second.applyTo(unitPrice, quantity, best);
+        if (!byCategory.empty()) {
+            auto categoryPlan = byCategory.find(product.category);
+            if (categoryPlan != byCategory.end())
+                categoryPlan->second.applyTo(unitPrice, quantity, best);
         }
+        return best;
+    }
+};
 
-        while (true) {
-            cout << "Enter Date (YYYY-MM-DD): ";
-            getline(cin, Date);
+// Holds the rule list and publishes compiled plans the same way the catalog
+// publishes versions: the order path only does an atomic load. A plan is
+// rebuilt when the rules change; the plan for the next time window is
+// compiled ahead on the engine's own thread, so crossing a window boundary
+// only swaps in a plan that is already built.
+class PromotionEngine {
+private:
+    mutex rulesLock;
+    condition_variable wakeUp;
+    vector<Promotion> promotions;
+    vector<PromotionRule> rules;
+    shared_ptr<const CompiledPromotions> compiled = make_shared<const CompiledPromotions>();
+    shared_ptr<const CompiledPromotions> upcoming;  // From compiled->validUntil on, once built
+    bool stopping = false;
+    thread worker;
 
-            if (isValidDate(Date)) {
-                cout << "Valid date entered: " << Date << endl;
-                break;  // Exit the loop if the date is valid
-            }
-            else {
-                cout << "Invalid date format. Please try again." << endl;
-            }
-        }
+    static bool covers(const shared_ptr<const CompiledPromotions>& plans, time_t now) {
+        return plans && now >= plans->validFrom && now < plans->validUntil;
+    }
 
-        productTree.insert(Product(id, name, category, price,
-            quantity, Date, discount, tax));
-        cout << "\nProduct added successfully.\n";
-        saveProductsToFile();
+    // Caller holds rulesLock
+    void publish(shared_ptr<const CompiledPromotions> plans) {
+        atomic_store(&compiled, move(plans));
+        upcoming.reset();
+        wakeUp.notify_one();
     }
 
-    void showAvailableProducts() {
-        vector<Product> products = productTree.getAllProducts();
-        if (products.empty()) {
-            cout << "\nNo products available.\n";
-            return;
-        }
-        cout << "\nAvailable Products:\n";
-        cout << left << setw(10) << "ID" << setw(20) << "Name"
-            << setw(20) << "Category" << setw(10) << "Price"
-            << setw(10) << "Qty" << setw(10) << "Discount"
-            << setw(10) << "Tax" << setw(15) << "Date" << "\n";
-        cout << string(105, '-') << "\n";
-        for (const auto& product : products) {
-            cout << left << setw(10) << product.id
-                << setw(20) << product.name
-                << setw(20) << product.category
-                << setw(10) << fixed << setprecision(2) << product.price
-                << setw(10) << product.quantity
-                << setw(10) << product.discount << "%"  // Percentage sign for discount
-                << setw(10) << product.tax << "%"       // Percentage sign for tax
-                << setw(15) << product.Date << "\n";    // No percentage sign for date
-        }
+    void recompile(time_t now) {
+        publish(make_shared<const CompiledPromotions>(rules, now));
     }
-    void addAdmin() {
-        string username, password;
-        cout << "\nEnter New Admin Username: ";
+
+    bool upcomingNeeded() {
+        return !upcoming && compiled->validUntil != numeric_limits<time_t>::max();
+    }
+
+    // Compiles from a copy of the rules without the lock; the result is
+    // dropped if the rules or the current plan changed meanwhile
+    void run() {
+        unique_lock<mutex> guard(rulesLock);
         while (true) {
-            if (getValidatedString(username)) {
+            wakeUp.wait(guard, [&] { return stopping || upcomingNeeded(); });
+            if (stopping)
                 break;
-            }
-            cout << "Invalid input for username. Please try again: ";
+            shared_ptr<const CompiledPromotions> base = compiled;
+            vector<PromotionRule> ruleCopy = rules;
+            guard.unlock();
+            auto next = make_shared<const CompiledPromotions>(ruleCopy, base->validUntil);
+            guard.lock();
+            if (compiled == base)
+                upcoming = move(next);
         }
-        cout << "Enter New Admin Password: ";
-        while (true) {
-            if (getValidatedString(password)) {
-                break;
-            }
-            cout << "Invalid input for password. Please try again: ";
+    }
+
+public:
+    PromotionEngine() : worker(&PromotionEngine::run, this) {}
+
+    ~PromotionEngine() {
+        {
+            lock_guard<mutex> guard(rulesLock);
+            stopping = true;
         }
-        admins.emplace_back(username, password);
-        cout << "\nAdmin added successfully.\n";
-        saveAdminsToFile();
+        wakeUp.notify_one();
+        worker.join();
     }
 
-    void placeOrder() {
-        int id;
-        int orderQuantity;
-        cout << "\nEnter Product ID to order: ";
-        while (!getValidatedInteger(id)) {
-            cout << "Invalid input. Please enter a valid product ID: ";
+    shared_ptr<const CompiledPromotions> plansAt(time_t now) {
+        auto plans = atomic_load(&compiled);
+        if (covers(plans, now))
+            return plans;
+        lock_guard<mutex> guard(rulesLock);
+        plans = atomic_load(&compiled);
+        if (!covers(plans, now)) {
+            if (covers(upcoming, now))
+                publish(upcoming);
+            else
+                recompile(now);  // Clock moved past the prepared window, or it is not built yet
+            plans = atomic_load(&compiled);
         }
-        Product* product = productTree.search(id);
-        if (product) {
-            cout << "Enter Quantity to order: ";
-            while (!getValidatedInteger(orderQuantity)) {
-                cout << "Invalid input. Please enter a valid quantity: ";
-            }
-            if (orderQuantity > product->quantity) {
-                cout << "\nNot enough stock available. Order quantity exceeds available stock.\n";
+        return plans;
+    }
+
+    // True once the plan for the window after the current one is built
+    bool nextWindowReady() {
+        lock_guard<mutex> guard(rulesLock);
+        return !upcomingNeeded();
+    }
+
+    // Order total after the best active promotion
+    double orderTotal(const Product& product, double unitPrice, int quantity, time_t now) {
+        return plansAt(now)->orderTotal(product, unitPrice, quantity);
+    }
+
+    // Replace every rule; records that fail the checks are returned with the reason
+    vector<pair<Promotion, string>> load(const vector<Promotion>& incoming) {
+        vector<pair<Promotion, string>> rejected;
+        lock_guard<mutex> guard(rulesLock);
+        promotions.clear();
+        rules.clear();
+        for (const auto& promotion : incoming) {
+            PromotionRule rule;
+            string error;
+            if (compilePromotionRule(promotion, rule, error)) {
+                promotions.push_back(promotion);
+                rules.push_back(rule);
             }
             else {
-                product->quantity -= orderQuantity;
-                double discountedPrice = product->price * (1 - product->discount / 100);
-                double taxedPrice = discountedPrice * (1 + product->tax / 100);
-                double totalPrice = taxedPrice * orderQuantity;
-                cout << "\nOrder placed successfully.\n";
-                cout << "Total Bill: Rs." << fixed << setprecision(2) << totalPrice << "\n";
-                // Save order info
-                ofstream orderFile(ordersFile, ios::app);
-                orderFile << "Product ID: " << product->id << "\n";
-                orderFile << "Product Name: " << product->name << "\n";
-                orderFile << "Quantity Ordered: " << orderQuantity << "\n";
-                orderFile << "Total Price: Rs." << fixed << setprecision(2) << totalPrice << "\n\n";
-                orderFile.close();
-                saveProductsToFile();
+                rejected.emplace_back(promotion, error);
             }
         }
-        else {
-            cout << "\nProduct not found.\n";
-        }
+        recompile(time(nullptr));
+        return rejected;
     }
 
-    // Modified checkLowStockLevels: if there are no products, show "No products available."
-    void checkLowStockLevels() {
-        vector<Product> products = productTree.getAllProducts();
-        if (products.empty()) {
-            cout << "\nNo products available.\n";
-            return;
-        }
-        bool lowStockFound = false;
-        cout << "\nChecking for low stock levels...\n";
-        for (const auto& product : products) {
-            if (product.quantity < 20) {
-                cout << "Warning: Product ID " << product.id
-                    << " (" << product.name << ") has low stock. Current quantity: "
-                    << product.quantity << "\n";
-                lowStockFound = true;
+    // Adds the rule with the next free id; false with a reason if it is invalid
+    bool add(Promotion promotion, string& error) {
+        lock_guard<mutex> guard(rulesLock);
+        promotion.id = 1;
+        for (const auto& existing : promotions)
+            promotion.id = max(promotion.id, existing.id + 1);
+        PromotionRule rule;
+        if (!compilePromotionRule(promotion, rule, error))
+            return false;
+        promotions.push_back(promotion);
+        rules.push_back(rule);
+        recompile(time(nullptr));
+        return true;
+    }
+
+    bool remove(int id) {
+        lock_guard<mutex> guard(rulesLock);
+        for (size_t i = 0; i < promotions.size(); i++) {
+            if (promotions[i].id == id) {
+                promotions.erase(promotions.begin() + i);
+                rules.erase(rules.begin() + i);
+                recompile(time(nullptr));
+                return true;
             }
         }
-        if (!lowStockFound)
-            cout << "No products have low stock levels.\n";
+        return false;
+    }
+
+    vector<Promotion> list() {
+        lock_guard<mutex> guard(rulesLock);
+        return promotions;
+    }
+
+    string render() {
+        string out;
+        for (const auto& promotion : list())
+            appendRecordCSV<CsvStyle::Exact>(out, promotion, promotionColumns);
+        return out;
     }
+};
 
+// --------------------- Stock Reservations ---------------------
+// Holds set units of a product aside for a while (e.g. while a customer
+// pays) until they are confirmed as a sale, released, or expire. Units held
+// per product are kept as a running total, so available stock is quantity
+// minus one lookup. Expiry uses a timer wheel: a hold is filed in the slot
+// for its expiry tick, and advancing the clock only visits the slots of the
+// ticks that passed. Holds due more than one turn ahead wait in an overflow
+// list keyed by the turn they expire in and are moved into the wheel when
+// that turn comes, so each hold is filed at most twice whatever its TTL;
+// released holds are dropped from their slot or list lazily. Only expireDue() and stats() turn the wheel, so
+// callers can do it before taking the catalog write lock; lookups made under
+// that lock just treat a hold past its expiry as gone.
+class ReservationBook {
 public:
-    PointOfSaleSystem() {
-        loadAdminsFromFile();
-        loadProductsFromFile();
-        loadWishlistFromFile();
+    struct Hold {
+        int productId;
+        int quantity;
+        long long expiresTick;
+    };
+
+    struct Stats {
+        size_t active;
+        unsigned long long placed;
+        unsigned long long confirmed;
+        unsigned long long released;
+        unsigned long long expired;
+    };
+
+private:
+    static const int wheelSlots = 1024;
+    static constexpr chrono::milliseconds tickLength{ 100 };
+
+    mutex bookLock;
+    unordered_map<unsigned long long, Hold> holds;
+    unordered_map<int, long long> reserved;  // Units held per product
+    vector<vector<unsigned long long>> wheel{ wheelSlots };
+    map<long long, vector<unsigned long long>> overflow;  // By expiry tick / wheelSlots
+    const chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+    long long nextTick = 0;  // Every tick before this has been expired
+    unsigned long long nextHoldId = 1;
+    unsigned long long holdIdStep = 1;
+    Stats counts{};
+
+    long long tickAt(chrono::steady_clock::time_point when) const {
+        return (long long)((when - epoch) / tickLength);
     }
 
-    ~PointOfSaleSystem() {
-        saveAdminsToFile();
-        saveProductsToFile();
-        saveWishlistToFile();
+    // Caller holds bookLock
+    unordered_map<unsigned long long, Hold>::iterator findLive(unsigned long long holdId) {
+        auto found = holds.find(holdId);
+        if (found != holds.end() && found->second.expiresTick <= tickAt(chrono::steady_clock::now()))
+            return holds.end();  // Expired; the wheel removes it on its next turn
+        return found;
     }
 
-    void showHeader() {
-        cout << "=============================================" << endl;
-        cout << "   RIPHAH INTERNATIONAL UNIVERSITY SAHIWAL   " << endl;
-        cout << "=============================================" << endl;
-        cout << "\n---------------------------------------------" << endl;
-        cout << "            E-Sales Terminal:)              " << endl;
-        cout << "---------------------------------------------" << endl;
-        cout << "   1. Admin.                                 " << endl;
-        cout << "   2. Customer.                              " << endl;
-        cout << "   3. Exit.                                  " << endl;
-        cout << "---------------------------------------------" << endl;
+    // Caller holds bookLock
+    void remove(unordered_map<unsigned long long, Hold>::iterator hold) {
+        auto units = reserved.find(hold->second.productId);
+        if ((units->second -= hold->second.quantity) == 0)
+            reserved.erase(units);
+        holds.erase(hold);
     }
 
-    bool login() {
-        string username, password;
-        // This loop will keep asking for valid credentials
-        while (true) {
-            cout << "Enter admin username: ";
-            while (!getValidatedString(username)) {
-                cout << "Invalid input for username. Please try again: ";
-            }
+    // Caller holds bookLock
+    void file(unsigned long long holdId, long long expiresTick) {
+        if (expiresTick - nextTick < wheelSlots)
+            wheel[expiresTick % wheelSlots].push_back(holdId);
+        else
+            overflow[expiresTick / wheelSlots].push_back(holdId);
+    }
 
-            cout << "Enter admin password: ";
-            while (!getValidatedString(password)) {
-                cout << "Invalid input for password. Please try again: ";
+    // Expire everything due by now. Caller holds bookLock.
+    void advance() {
+        long long now = tickAt(chrono::steady_clock::now());
+        // Holds expiring before the end of the coming turn move into the wheel
+        while (!overflow.empty() && overflow.begin()->first <= now / wheelSlots) {
+            for (unsigned long long id : overflow.begin()->second) {
+                auto hold = holds.find(id);
+                if (hold != holds.end())
+                    wheel[hold->second.expiresTick % wheelSlots].push_back(id);
             }
-
-            // Check credentials
-            for (const auto& admin : admins) {
-                if (admin.first == username && admin.second == password) {
-                    cout << "\nSuccessfully logged in!\n";
-                    return true;
+            overflow.erase(overflow.begin());
+        }
+        // After a long idle gap one pass over every slot covers all the missed ticks
+        long long first = max(nextTick, now - wheelSlots + 1);
+        for (long long tick = first; tick <= now; tick++) {
+            vector<unsigned long long>& slot = wheel[tick % wheelSlots];
+            size_t kept = 0;
+            for (unsigned long long id : slot) {
+                auto hold = holds.find(id);
+                if (hold == holds.end())
+                    continue;  // Confirmed or released already
+                if (hold->second.expiresTick <= now) {
+                    remove(hold);
+                    counts.expired++;
+                }
+                else {
+                    slot[kept++] = id;  // Due on a later turn of the wheel
                 }
             }
-            cout << "\nAccess denied. Invalid username or password. Please try again.\n";
+            slot.resize(kept);
+        }
+        nextTick = max(nextTick, now + 1);
+    }
+
+public:
+    // Hold ids are first, first + step, ... so shard workers can share one id space
+    void numberHolds(unsigned long long first, unsigned long long step) {
+        lock_guard<mutex> guard(bookLock);
+        nextHoldId = first;
+        holdIdStep = step;
+    }
+
+    void expireDue() {
+        lock_guard<mutex> guard(bookLock);
+        advance();
+    }
+
+    // Units held, counting holds that expired since the last expireDue()
+    long long reservedUnits(int productId) {
+        lock_guard<mutex> guard(bookLock);
+        auto units = reserved.find(productId);
+        return units == reserved.end() ? 0 : units->second;
+    }
+
+    // Hold quantity units if stock minus what is already held covers them.
+    // The caller keeps stock from changing meanwhile (catalog write lock).
+    bool place(int productId, int quantity, int stock, chrono::seconds ttl, unsigned long long& holdId) {
+        lock_guard<mutex> guard(bookLock);
+        long long& units = reserved[productId];
+        if (quantity > stock - units) {
+            if (units == 0)
+                reserved.erase(productId);
+            return false;
+        }
+        units += quantity;
+        holdId = nextHoldId;
+        nextHoldId += holdIdStep;
+        long long expiresTick = max(nextTick, tickAt(chrono::steady_clock::now() + ttl));
+        holds.emplace(holdId, Hold{ productId, quantity, expiresTick });
+        file(holdId, expiresTick);
+        counts.placed++;
+        return true;
+    }
+
+    bool find(unsigned long long holdId, Hold& hold) {
+        lock_guard<mutex> guard(bookLock);
+        auto found = findLive(holdId);
+        if (found == holds.end())
+            return false;
+        hold = found->second;
+        return true;
+    }
+
+    // Remove a live hold so its units can be sold; false if it is gone
+    bool take(unsigned long long holdId, Hold& hold) {
+        lock_guard<mutex> guard(bookLock);
+        auto found = findLive(holdId);
+        if (found == holds.end())
+            return false;
+        hold = found->second;
+        remove(found);
+        counts.confirmed++;
+        return true;
+    }
+
+    bool release(unsigned long long holdId) {
+        lock_guard<mutex> guard(bookLock);
+        auto found = findLive(holdId);
+        if (found == holds.end())
+            return false;
+        remove(found);
+        counts.released++;
+        return true;
+    }
+
+    Stats stats() {
+        lock_guard<mutex> guard(bookLock);
+        advance();
+        Stats current = counts;
+        current.active = holds.size();
+        return current;
+    }
+};
+
+// --------------------- Linked List for Wishlist ---------------------
+struct ListNode {
+    Product product;
+    ListNode* next;
+
+    ListNode(Product p) : product(p), next(nullptr) {}
+};
+
+class LinkedList {
+private:
+    ListNode* head;
+public:
+    LinkedList() : head(nullptr) {}
+
+    void add(Product product) {
+        ListNode* newNode = new ListNode(product);
+        newNode->next = head;
+        head = newNode;
+    }
+
+    void remove(int id) {
+        ListNode* temp = head;
+        ListNode* prev = nullptr;
+        while (temp && temp->product.id != id) {
+            prev = temp;
+            temp = temp->next;
+        }
+        if (!temp) return;  // not found
+        if (!prev)
+            head = temp->next;
+        else
+            prev->next = temp->next;
+        delete temp;
+    }
+
+    vector<Product> getAll() {
+        vector<Product> products;
+        ListNode* temp = head;
+        while (temp) {
+            products.push_back(temp->product);
+            temp = temp->next;
+        }
+        return products;
+    }
+
+    bool isEmpty() {
+        return (head == nullptr);
+    }
+};
+
+// --------------------- Order History Stack ---------------------
+class OrderStack {
+private:
+    stack<Product> orders;
+public:
+    void push(Product product) {
+        orders.push(product);
+    }
+    Product pop() {
+        Product product = orders.top();
+        orders.pop();
+        return product;
+    }
+    bool isEmpty() {
+        return orders.empty();
+    }
+};
+
+// --------------------- Low Stock Alerts Queue ---------------------
+class LowStockQueue {
+private:
+    queue<Product> lowStockProducts;
+public:
+    void enqueue(Product product) {
+        lowStockProducts.push(product);
+    }
+    Product dequeue() {
+        Product product = lowStockProducts.front();
+        lowStockProducts.pop();
+        return product;
+    }
+    bool isEmpty() {
+        return lowStockProducts.empty();
+    }
+};
+
+// --------------------- Snapshot Persistence ---------------------
+#ifdef __linux__
+// pwrite() the whole buffer, retrying short writes
+bool writeAllAt(int fd, const char* data, size_t length, off_t offset) {
+    size_t written = 0;
+    while (written < length) {
+        ssize_t n = pwrite(fd, data + written, length - written, offset + written);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        written += n;
+    }
+    return true;
+}
+
+// Minimal io_uring over the raw system calls (no liburing needed). The
+// background I/O threads use it to hand a write and its fdatasync to the
+// kernel as one linked submission: one system call instead of two. If the
+// kernel or a sandbox refuses io_uring, available() is false and callers
+// fall back to blocking pwrite()/fdatasync().
+class IoRing {
+private:
+    int ringFd = -1;
+    void* sqRing = MAP_FAILED;
+    void* cqRing = MAP_FAILED;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    size_t sqesSize = 0;
+    io_uring_sqe* sqes = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    void release() {
+        if (sqes)
+            munmap(sqes, sqesSize);
+        if (cqRing != MAP_FAILED && cqRing != sqRing)
+            munmap(cqRing, cqRingSize);
+        if (sqRing != MAP_FAILED)
+            munmap(sqRing, sqRingSize);
+        if (ringFd >= 0)
+            close(ringFd);
+        ringFd = -1;
+        sqRing = cqRing = MAP_FAILED;
+        sqes = nullptr;
+    }
+
+    void queue(const io_uring_sqe& entry, unsigned& tail) {
+        unsigned index = tail & *sqMask;
+        sqes[index] = entry;
+        sqArray[index] = index;
+        tail++;
+    }
+
+public:
+    IoRing() {
+        io_uring_params params{};
+        ringFd = (int)syscall(__NR_io_uring_setup, 4, &params);
+        if (ringFd < 0)
+            return;
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (singleMap)
+            sqRingSize = cqRingSize = max(sqRingSize, cqRingSize);
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ringFd, IORING_OFF_SQ_RING);
+        cqRing = singleMap ? sqRing : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* entries = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ringFd, IORING_OFF_SQES);
+        if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || entries == MAP_FAILED) {
+            release();
+            return;
+        }
+        sqes = (io_uring_sqe*)entries;
+        char* sq = (char*)sqRing;
+        char* cq = (char*)cqRing;
+        sqTail = (unsigned*)(sq + params.sq_off.tail);
+        sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+        sqArray = (unsigned*)(sq + params.sq_off.array);
+        cqHead = (unsigned*)(cq + params.cq_off.head);
+        cqTail = (unsigned*)(cq + params.cq_off.tail);
+        cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+        cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+    }
+
+    ~IoRing() {
+        release();
+    }
+
+    IoRing(const IoRing&) = delete;
+    IoRing& operator=(const IoRing&) = delete;
+
+    bool available() const {
+        return ringFd >= 0;
+    }
+
+    // Write length bytes at offset and, if sync is set, fdatasync after the
+    // write succeeds. Waits for completion. A short write is finished with
+    // pwrite(); an opcode the kernel does not know disables the ring.
+    // Completions may arrive in any order, so each is matched to its
+    // request by user_data.
+    bool writeAndSync(int fd, const char* data, size_t length, off_t offset, bool sync) {
+        enum : unsigned long long { writeTag = 1, syncTag = 2 };
+        iovec buffer{ (void*)data, length };
+        io_uring_sqe write{};
+        write.opcode = IORING_OP_WRITEV;
+        write.fd = fd;
+        write.addr = (unsigned long long)&buffer;
+        write.len = 1;
+        write.off = offset;
+        write.flags = sync ? IOSQE_IO_LINK : 0;
+        write.user_data = writeTag;
+        io_uring_sqe fsync{};
+        fsync.opcode = IORING_OP_FSYNC;
+        fsync.fd = fd;
+        fsync.fsync_flags = IORING_FSYNC_DATASYNC;
+        fsync.user_data = syncTag;
+
+        unsigned tail = *sqTail;
+        queue(write, tail);
+        if (sync)
+            queue(fsync, tail);
+        __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+
+        unsigned expected = sync ? 2 : 1;
+        unsigned toSubmit = expected;
+        unsigned completed = 0;
+        int written = 0, synced = 0;
+        while (completed < expected) {
+            unsigned head = *cqHead;
+            unsigned available = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+            for (; head != available && completed < expected; head++) {
+                const io_uring_cqe& completion = cqes[head & *cqMask];
+                if (completion.user_data == writeTag)
+                    written = completion.res;
+                else if (completion.user_data == syncTag)
+                    synced = completion.res;
+                else
+                    continue;  // Not one of ours
+                completed++;
+            }
+            __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+            if (completed == expected)
+                break;
+            int entered = (int)syscall(__NR_io_uring_enter, ringFd, toSubmit, 1,
+                IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (entered < 0 && errno != EINTR) {
+                release();  // Ring unusable: finish this request the blocking way
+                return writeAllAt(fd, data, length, offset) && (!sync || fdatasync(fd) == 0);
+            }
+            if (entered > 0)
+                toSubmit -= min<unsigned>(toSubmit, entered);
+        }
+
+        if (written == -EINVAL || written == -EOPNOTSUPP) {
+            release();
+            return writeAllAt(fd, data, length, offset) && (!sync || fdatasync(fd) == 0);
+        }
+        if (written < 0)
+            return false;
+        if ((size_t)written < length) {
+            // The linked fsync was cancelled; finish both by hand
+            return writeAllAt(fd, data + written, length - written, offset + written)
+                && (!sync || fdatasync(fd) == 0);
+        }
+        return !sync || synced == 0;
+    }
+};
+#else
+// No io_uring elsewhere: background threads always write the blocking way
+class IoRing {
+public:
+    bool available() const {
+        return false;
+    }
+};
+#endif
+
+// Replace a file so that a crash leaves either the old or the new contents,
+// never a truncated mix: write a temp file, fsync it, rename it over the
+// original and fsync the directory so the rename itself is durable. A
+// background thread may pass its IoRing to submit the write and fsync together.
+#ifdef __linux__
+// Make a rename in path's directory durable
+void syncDirectoryOf(const string& path) {
+    size_t slash = path.rfind('/');
+    string directory = (slash == string::npos) ? "." : path.substr(0, slash + 1);
+    int dirFd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+}
+
+bool writeFileAtomically(const string& path, const string& contents, IoRing* ring = nullptr) {
+    string tempPath = path + ".tmp";
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return false;
+    bool written = (ring && ring->available())
+        ? ring->writeAndSync(fd, contents.data(), contents.size(), 0, true)
+        : writeAllAt(fd, contents.data(), contents.size(), 0) && fsync(fd) == 0;
+    close(fd);
+    if (!written || rename(tempPath.c_str(), path.c_str()) != 0) {
+        unlink(tempPath.c_str());
+        return false;
+    }
+    syncDirectoryOf(path);
+    return true;
+}
+#else
+bool writeFileAtomically(const string& path, const string& contents, IoRing* = nullptr) {
+    string tempPath = path + ".tmp";
+    {
+        ofstream file(tempPath, ios::trunc);
+        file << contents;
+        file.flush();
+        if (!file)
+            return false;
+    }
+    remove(path.c_str());
+    return rename(tempPath.c_str(), path.c_str()) == 0;
+}
+#endif
+
+// Writes snapshots on a background thread. Callers hand over a render
+// function that owns a consistent view of the data (for products, an O(1)
+// CatalogSnapshot), so formatting and disk I/O never block a sale. If a file
+// is scheduled again before its previous snapshot was written, only the
+// newest one is written. An optional written callback runs on the
+// background thread once that snapshot is safely on disk. The thread never
+// prints; failures are queued for the interactive thread (takeFailures()).
+class Checkpointer {
+private:
+    struct Job {
+        function<string()> render;
+        function<bool()> written;  // Returns false if its follow-up work failed
+    };
+
+    mutex lock;
+    condition_variable wakeUp;
+    condition_variable idle;
+    map<string, Job> pending;
+    bool writing = false;
+    bool stopping = false;
+    vector<string> failures;
+    thread worker;
+
+    void run() {
+        IoRing ring;  // Owned by this thread; rings are not shared
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            wakeUp.wait(guard, [&] { return stopping || !pending.empty(); });
+            if (pending.empty())
+                break;  // Stopping and fully drained
+            auto job = pending.begin();
+            string path = job->first;
+            Job current = move(job->second);
+            pending.erase(job);
+            writing = true;
+            guard.unlock();
+
+            bool saved = writeFileAtomically(path, current.render(), &ring);
+            bool followedUp = !saved || !current.written || current.written();
+
+            guard.lock();
+            writing = false;
+            if (!saved)
+                failures.push_back("Error saving snapshot to " + path + ".");
+            else if (!followedUp)
+                failures.push_back("Error cleaning up after saving " + path + ".");
+            if (pending.empty())
+                idle.notify_all();
+        }
+    }
+
+public:
+    Checkpointer() : worker(&Checkpointer::run, this) {}
+
+    ~Checkpointer() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wakeUp.notify_one();
+        worker.join();
+    }
+
+    void schedule(const string& path, function<string()> render, function<bool()> written = nullptr) {
+        {
+            lock_guard<mutex> guard(lock);
+            pending[path] = Job{ move(render), move(written) };
+        }
+        wakeUp.notify_one();
+    }
+
+    // Failures since the last call, for the caller to report
+    vector<string> takeFailures() {
+        lock_guard<mutex> guard(lock);
+        vector<string> taken;
+        taken.swap(failures);
+        return taken;
+    }
+
+    // Block until every scheduled snapshot has been written
+    void waitUntilIdle() {
+        unique_lock<mutex> guard(lock);
+        idle.wait(guard, [&] { return pending.empty() && !writing; });
+    }
+};
+
+// --------------------- Order Journal ---------------------
+// How long an order waits for its journal record before it is acknowledged:
+// Async   - as soon as the record is queued (a crash can lose the last few)
+// Written - once the record is written to the operating system (old behaviour)
+// Synced  - once the record has been fdatasync'ed to disk
+enum class Durability { Async, Written, Synced };
+
+// Set from --durability and --inline-io; used by every mode that takes orders
+struct PersistenceOptions {
+    Durability durability = Durability::Written;
+    bool journalIoThread = true;
+};
+
+PersistenceOptions persistenceOptions;
+
+// Append-only orders file fed through a dedicated I/O thread. Sales only
+// copy their record into a queue; the thread writes everything queued so far
+// as one batch (io_uring when available, blocking pwrite otherwise), so
+// several registers share one write and one fsync. waitUntilDurable() gives
+// each caller the acknowledgement its Durability level asks for. With the
+// I/O thread turned off, records are written inline by the caller, which is
+// how orders.csv used to be written. A failed write or sync latches the
+// journal: nothing after it is written, waitUntilDurable() reports failure
+// for every record the file may not hold, and callers stop taking orders.
+class OrderJournal {
+private:
+    mutex lock;
+    condition_variable wakeUp;
+    condition_variable progress;
+    string queued;
+    unsigned long long appendedSeq = 0;
+    unsigned long long writtenSeq = 0;
+    unsigned long long syncedSeq = 0;
+    unsigned long long batches = 0;
+    unsigned long long failedWrites = 0;  // Reported by the caller, not the I/O thread
+    bool failed = false;  // Latched by the first failed write; writtenSeq stops there
+    bool compacting = false;
+    Durability durability;
+    bool useIoThread;
+    bool stopping = false;
+    bool writing = false;  // The I/O thread is writing a batch without the lock
+    const string path;
+#ifdef __linux__
+    int fd = -1;
+    off_t offset = 0;
+#else
+    FILE* file = nullptr;
+#endif
+    thread worker;
+
+    // Write one batch at the end of the file; caller ensures a single writer
+    bool writeBatch(const string& batch, bool sync, IoRing* ring) {
+#ifdef __linux__
+        if (fd < 0)
+            return false;
+        bool ok = (ring && ring->available())
+            ? ring->writeAndSync(fd, batch.data(), batch.size(), offset, sync)
+            : writeAllAt(fd, batch.data(), batch.size(), offset) && (!sync || fdatasync(fd) == 0);
+        if (ok)
+            offset += batch.size();
+        return ok;
+#else
+        (void)sync;
+        (void)ring;
+        return file && fwrite(batch.data(), 1, batch.size(), file) == batch.size() && fflush(file) == 0;
+#endif
+    }
+
+    // Record how a batch ending at seq went; lock held
+    void settle(unsigned long long seq, bool ok, bool sync) {
+        if (!ok) {
+            failedWrites++;
+            failed = true;
+            return;
+        }
+        writtenSeq = seq;
+        if (sync)
+            syncedSeq = seq;
+        batches++;
+    }
+
+    void run() {
+        IoRing ring;
+        string batch;
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            wakeUp.wait(guard, [&] { return stopping || !queued.empty(); });
+            if (queued.empty())
+                break;
+            batch.swap(queued);
+            unsigned long long batchSeq = appendedSeq;
+            writing = true;
+            guard.unlock();
+
+            bool sync = durability == Durability::Synced;
+            bool ok = !failed && writeBatch(batch, sync, &ring);
+            batch.clear();
+
+            guard.lock();
+            writing = false;
+            settle(batchSeq, ok, sync);
+            progress.notify_all();
+        }
+    }
+
+    // End of what has been written so far; lock held and no batch in flight
+    unsigned long long writtenBytes() {
+#ifdef __linux__
+        return (unsigned long long)offset;
+#else
+        return file ? (unsigned long long)ftell(file) : 0;
+#endif
+    }
+
+    // Append bytes [from, to) of the journal file to segment
+    bool copyRange(FILE* segment, unsigned long long from, unsigned long long to) {
+        if (from == to)
+            return true;
+        ifstream source(path, ios::binary);
+        string bytes(to - from, '\0');
+        source.seekg((streamoff)from);
+        return source.read(&bytes[0], bytes.size())
+            && fwrite(bytes.data(), 1, bytes.size(), segment) == bytes.size();
+    }
+
+    static bool syncSegment(FILE* segment) {
+#ifdef __linux__
+        return fflush(segment) == 0 && fdatasync(fileno(segment)) == 0;
+#else
+        return fflush(segment) == 0;
+#endif
+    }
+
+    // Put the new segment in place of the file and reopen it for appends;
+    // lock held and no batch in flight
+    bool swapInSegment(const string& segmentPath) {
+#ifdef __linux__
+        if (rename(segmentPath.c_str(), path.c_str()) != 0)
+            return false;
+        syncDirectoryOf(path);
+        if (fd >= 0)
+            close(fd);
+        fd = open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+        offset = fd >= 0 ? lseek(fd, 0, SEEK_END) : 0;
+        return fd >= 0;
+#else
+        if (file)
+            fclose(file);
+        remove(path.c_str());
+        bool renamed = rename(segmentPath.c_str(), path.c_str()) == 0;
+        file = fopen(path.c_str(), "ab");
+        return renamed && file != nullptr;
+#endif
+    }
+
+public:
+    OrderJournal(const string& path, Durability durability, bool useIoThread)
+        : durability(durability), useIoThread(useIoThread), path(path) {
+#ifdef __linux__
+        fd = open(path.c_str(), O_WRONLY | O_CREAT, 0644);
+        if (fd >= 0)
+            offset = lseek(fd, 0, SEEK_END);
+#else
+        file = fopen(path.c_str(), "ab");
+#endif
+        if (useIoThread)
+            worker = thread(&OrderJournal::run, this);
+    }
+
+    ~OrderJournal() {
+        if (useIoThread) {
+            {
+                lock_guard<mutex> guard(lock);
+                stopping = true;
+            }
+            wakeUp.notify_one();
+            worker.join();
+        }
+#ifdef __linux__
+        if (fd >= 0) {
+            if (durability != Durability::Synced)
+                fdatasync(fd);
+            close(fd);
+        }
+#else
+        if (file)
+            fclose(file);
+#endif
+    }
+
+    // Queue one record; returns its sequence number
+    unsigned long long append(const string& record) {
+        lock_guard<mutex> guard(lock);
+        unsigned long long seq = ++appendedSeq;
+        if (!useIoThread) {
+            bool sync = durability == Durability::Synced;
+            settle(seq, !failed && writeBatch(record, sync, nullptr), sync);
+            return seq;
+        }
+        queued += record;
+        if (queued.size() == record.size())
+            wakeUp.notify_one();  // Only the first record of a batch wakes the thread
+        return seq;
+    }
+
+    unsigned long long lastAppended() {
+        lock_guard<mutex> guard(lock);
+        return appendedSeq;
+    }
+
+    // Block until record seq is as durable as the configured level requires;
+    // false if a failed write means it may never be. Async only reports a
+    // failure that has already happened.
+    bool waitUntilDurable(unsigned long long seq) {
+        unique_lock<mutex> guard(lock);
+        if (durability == Durability::Async)
+            return !failed;
+        unsigned long long& durableSeq = durability == Durability::Synced ? syncedSeq : writtenSeq;
+        progress.wait(guard, [&] { return durableSeq >= seq || failed; });
+        return durableSeq >= seq;
+    }
+
+    // False once a write has failed: new records would not be saved
+    bool healthy() {
+        lock_guard<mutex> guard(lock);
+        return !failed;
+    }
+
+    // Rewrite the file keeping only the lines keep() accepts, e.g. to drop
+    // records a checkpoint has made redundant. The kept lines go to a new
+    // segment without the lock, so appends carry on meanwhile; records
+    // appended since are copied across after them, and only the last short
+    // stretch of those, the rename and the reopen hold appends back.
+    bool compact(function<bool(string_view)> keep) {
+        unique_lock<mutex> guard(lock);
+        progress.wait(guard, [&] { return !writing && !compacting; });
+        unsigned long long cut = writtenBytes();
+        compacting = true;
+        guard.unlock();
+
+        string contents, kept;
+        {
+            ifstream file(path, ios::binary);
+            contents.resize(cut);
+            file.read(&contents[0], cut);
+            contents.resize(file.gcount());
+        }
+        size_t lineStart = 0;
+        while (lineStart < contents.size()) {
+            size_t lineEnd = contents.find('\n', lineStart);
+            lineEnd = lineEnd == string::npos ? contents.size() : lineEnd + 1;
+            string_view line(contents.data() + lineStart, lineEnd - lineStart);
+            if (keep(line.substr(0, line.size() - (line.back() == '\n' ? 1 : 0))))
+                kept += line;
+            lineStart = lineEnd;
+        }
+
+        bool ok = contents.size() == cut;
+        string segmentPath = path + ".compact";
+        FILE* segment = nullptr;
+        if (ok && kept.size() < contents.size()) {
+            segment = fopen(segmentPath.c_str(), "wb");
+            ok = segment && fwrite(kept.data(), 1, kept.size(), segment) == kept.size() && syncSegment(segment);
+        }
+        if (segment && ok) {
+            // Catch up without the lock until what is left is short
+            const unsigned long long shortTail = 64 * 1024;
+            unsigned long long copied = cut;
+            guard.lock();
+            while (ok) {
+                progress.wait(guard, [&] { return !writing; });
+                unsigned long long end = writtenBytes();
+                if (end - copied <= shortTail) {
+                    ok = copyRange(segment, copied, end) && syncSegment(segment);
+                    break;
+                }
+                guard.unlock();
+                ok = copyRange(segment, copied, end);
+                copied = end;
+                guard.lock();
+            }
+            fclose(segment);
+            segment = nullptr;
+            ok = ok && swapInSegment(segmentPath);
+            guard.unlock();
+        }
+        if (segment)
+            fclose(segment);
+        if (!ok)
+            remove(segmentPath.c_str());
+
+        guard.lock();
+        compacting = false;
+        progress.notify_all();
+        return ok;
+    }
+
+    // Failed writes since the last call
+    unsigned long long takeFailedWrites() {
+        lock_guard<mutex> guard(lock);
+        unsigned long long failed = failedWrites;
+        failedWrites = 0;
+        return failed;
+    }
+
+    // Records per write so far, to see how well sales are being batched
+    double recordsPerBatch() {
+        lock_guard<mutex> guard(lock);
+        return batches ? (double)writtenSeq / batches : 0;
+    }
+};
+
+// One row of the structured order log (orderlog.csv)
+struct LoggedOrder {
+    unsigned long long sequence = 0;
+    long long timeMillis = 0;
+    int productId = 0;
+    int quantity = 0;
+    double unitPrice = 0;
+    double totalPrice = 0;
+};
+
+bool parseLoggedOrder(string_view line, LoggedOrder& order) {
+    if (!line.empty() && line.back() == '\r')
+        line.remove_suffix(1);
+    const char* p = line.data();
+    const char* end = p + line.size();
+    auto field = [&](auto& value, bool last) {
+        auto result = from_chars(p, end, value);
+        if (result.ec != errc() || (last ? result.ptr != end : result.ptr == end || *result.ptr != ','))
+            return false;
+        p = result.ptr + (last ? 0 : 1);
+        return true;
+    };
+    return field(order.sequence, false) && field(order.timeMillis, false)
+        && field(order.productId, false) && field(order.quantity, false)
+        && field(order.unitPrice, false) && field(order.totalPrice, true);
+}
+
+// What startup recovery found in the order log
+struct ReplayStats {
+    unsigned long long snapshotSequence = 0;  // Last sale the snapshot held
+    unsigned long long lastSequence = 0;      // Last sale in the log
+    long long records = 0;
+    long long replayed = 0;
+    long long malformed = 0;
+    long long unknownProducts = 0;
+    size_t productsTouched = 0;
+    double seconds = 0;
+};
+
+// --------------------- Sales Analytics ---------------------
+tm toLocalTime(time_t when) {
+    tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &when);
+#else
+    localtime_r(&when, &local);
+#endif
+    return local;
+}
+
+// Local calendar date as YYYYMMDD
+int localDateKey(time_t when) {
+    tm local = toLocalTime(when);
+    return (local.tm_year + 1900) * 10000 + (local.tm_mon + 1) * 100 + local.tm_mday;
+}
+
+// Running totals updated on every sale, so dashboard queries cost
+// O(result) instead of a rescan of orders.csv. Rankings are kept in ordered
+// sets (re-keyed on each sale) and time series in pre-aggregated buckets.
+class SalesAnalytics {
+public:
+    struct ProductSales {
+        int id = 0;
+        string name;
+        string category;
+        long long units = 0;
+        double revenue = 0;
+    };
+
+    struct Bucket {
+        long long units = 0;
+        double revenue = 0;
+    };
+
+private:
+    mutable mutex lock;
+    unordered_map<int, ProductSales> byProduct;
+    set<pair<long long, int>> rankByUnits;   // (-units, id): best seller first
+    set<pair<double, int>> rankByRevenue;    // (-revenue, id)
+    map<string, double> revenueByCategory;
+    map<long long, Bucket> hourly;           // Key: hours since the epoch
+    map<int, Bucket> daily;                  // Key: local date YYYYMMDD
+    long long totalUnits = 0;
+    double totalRevenue = 0;
+
+    vector<ProductSales> top(size_t n, bool byRevenue) const {
+        lock_guard<mutex> guard(lock);
+        vector<ProductSales> result;
+        auto collect = [&](const auto& ranking) {
+            for (auto it = ranking.begin(); it != ranking.end() && result.size() < n; ++it)
+                result.push_back(byProduct.at(it->second));
+        };
+        if (byRevenue)
+            collect(rankByRevenue);
+        else
+            collect(rankByUnits);
+        return result;
+    }
+
+public:
+    // when == 0 records a sale with no known time (older journal entries):
+    // it counts towards totals and rankings but not the time series.
+    void recordSale(const Product& product, int units, double revenue, time_t when) {
+        lock_guard<mutex> guard(lock);
+        ProductSales& sales = byProduct[product.id];
+        if (sales.units > 0 || sales.revenue > 0) {
+            rankByUnits.erase({ -sales.units, product.id });
+            rankByRevenue.erase({ -sales.revenue, product.id });
+        }
+        sales.id = product.id;
+        sales.name = product.name;
+        sales.category = product.category;
+        sales.units += units;
+        sales.revenue += revenue;
+        rankByUnits.insert({ -sales.units, product.id });
+        rankByRevenue.insert({ -sales.revenue, product.id });
+
+        revenueByCategory[product.category] += revenue;
+        totalUnits += units;
+        totalRevenue += revenue;
+        if (when != 0) {
+            Bucket& hour = hourly[when / 3600];
+            hour.units += units;
+            hour.revenue += revenue;
+            Bucket& day = daily[localDateKey(when)];
+            day.units += units;
+            day.revenue += revenue;
+        }
+    }
+
+    vector<ProductSales> topByUnits(size_t n) const {
+        return top(n, false);
+    }
+
+    vector<ProductSales> topByRevenue(size_t n) const {
+        return top(n, true);
+    }
+
+    vector<pair<string, double>> categoryRevenue() const {
+        lock_guard<mutex> guard(lock);
+        return vector<pair<string, double>>(revenueByCategory.begin(), revenueByCategory.end());
+    }
+
+    // Non-empty hourly buckets in [from, to); keys are hours since the epoch
+    vector<pair<long long, Bucket>> hourlySeries(time_t from, time_t to) const {
+        lock_guard<mutex> guard(lock);
+        return vector<pair<long long, Bucket>>(hourly.lower_bound(from / 3600),
+            hourly.lower_bound(to / 3600 + (to % 3600 ? 1 : 0)));
+    }
+
+    // Non-empty daily buckets between two YYYYMMDD dates, inclusive
+    vector<pair<int, Bucket>> dailySeries(int fromDate, int toDate) const {
+        lock_guard<mutex> guard(lock);
+        return vector<pair<int, Bucket>>(daily.lower_bound(fromDate), daily.upper_bound(toDate));
+    }
+
+    Bucket totals() const {
+        lock_guard<mutex> guard(lock);
+        Bucket all;
+        all.units = totalUnits;
+        all.revenue = totalRevenue;
+        return all;
+    }
+};
+
+// --------------------- PointOfSaleSystem Class ---------------------
+class PointOfSaleSystem {
+private:
+    ProductTree productTree;
+    LinkedList wishlist;
+    OrderStack orderHistory;
+    LowStockQueue lowStockAlerts;
+    vector<pair<string, string>> admins;
+
+    // Updated file names for CSV files. A shard worker passes a suffix
+    // (e.g. ".shard2") so it gets products.shard2.csv and so on. Workers only
+    // serve the order protocol, so they keep just the catalog, order log and
+    // receipts; admins and the wishlist belong to the interactive terminal.
+    const bool shardWorker;
+    const string productFile;
+    const string adminFile;
+    const string ordersFile;
+    const string wishlistFile;
+    const string promotionsFile;  // Shared by every shard
+    const string orderLogFile;
+
+    // Sales are queued here and written by the journals' I/O threads
+    OrderJournal orderJournal;  // Receipts (orders.csv)
+    OrderJournal orderLog;      // Replayable rows (orderlog.csv)
+    ReplayStats lastReplay;
+    atomic<bool> productsDirty{ false };
+    SalesAnalytics analytics;
+    HotPriceCache priceCache;
+    PromotionEngine promotions;
+    CatalogSorter sorter;
+    SearchIndex searchIndex;
+    ReservationBook reservations;
+
+    // Declared last so it drains pending snapshots before anything else goes
+    Checkpointer checkpointer;
+
+    // Helper function to split a CSV line into tokens
+    vector<string> splitCSV(const string& line) {
+        vector<string> tokens;
+        stringstream ss(line);
+        string token;
+        while (getline(ss, token, ',')) {
+            tokens.push_back(token);
+        }
+        return tokens;
+    }
+
+    // Sort by id keeping the first record of each id; returns the ids dropped
+    static vector<int> sortAndRemoveDuplicates(vector<Product>& products) {
+        stable_sort(products.begin(), products.end());
+        vector<int> duplicates;
+        size_t kept = 0;
+        for (size_t i = 0; i < products.size(); i++) {
+            if (kept > 0 && products[kept - 1].id == products[i].id) {
+                duplicates.push_back(products[i].id);
+                continue;
+            }
+            if (kept != i)
+                products[kept] = move(products[i]);
+            kept++;
+        }
+        products.resize(kept);
+        return duplicates;
+    }
+
+    // ----------------------- Products -----------------------
+    void loadProductsFromFile() {
+        ifstream file(productFile);
+        if (!file) {
+            cout << "\nNo existing product records found. Starting fresh.\n";
+            return;
+        }
+        vector<Product> products;
+        unsigned long long snapshotSequence = 0;
+        bool hasSequence = false;
+        string line;
+        while (getline(file, line)) {
+            if (line.empty()) continue;
+            if (line.compare(0, 10, "#sequence,") == 0) {
+                hasSequence = from_chars(line.data() + 10, line.data() + line.size(), snapshotSequence).ec == errc();
+                continue;
+            }
+            Product product;
+            if (parseProductCSV(line, product))
+                products.push_back(product);
+            else
+                cout << "Skipping malformed record: " << line << "\n";
+        }
+        file.close();
+        for (const auto& id : sortAndRemoveDuplicates(products))
+            cout << "Skipping duplicate product ID: " << id << "\n";
+        productTree.bulkMerge(products, [](Product&, const Product&) {});
+        recoverFromOrderLog(snapshotSequence, hasSequence);
+        searchIndex.rebuild(productTree.snapshot());
+    }
+
+    static string renderProducts(const vector<Product>& products) {
+        string out;
+        for (const auto& product : products)
+            appendProductCSV<CsvStyle::Exact>(out, product);
+        return out;
+    }
+
+    // Queue a checkpoint of the current catalog; returns immediately. Once
+    // it is on disk, the order log rows it already contains are dropped.
+    void saveProductsToFile() {
+        CatalogSnapshot snapshot = productTree.snapshot();
+        unsigned long long sequence = snapshot.getSequence();
+        checkpointer.schedule(productFile, [snapshot] {
+            string out = "#sequence," + to_string(snapshot.getSequence()) + "\n";
+            snapshot.forEach([&](const Product& product) {
+                appendProductCSV<CsvStyle::Exact>(out, product);
+            });
+            return out;
+        }, [this, sequence] {
+            return orderLog.compact([sequence](string_view line) {
+                LoggedOrder order;
+                return !parseLoggedOrder(line, order) || order.sequence > sequence;
+            });
+        });
+    }
+
+    // Price, journal and count a sale whose stock is already taken; returns the total
+    double recordSale(const Product& sold, int orderQuantity, unsigned long long sequence,
+        uint64_t cacheGeneration) {
+        double unitPrice;
+        if (!priceCache.lookup(sold.id, unitPrice)) {
+            unitPrice = finalUnitPrice(sold);
+            priceCache.store(sold.id, unitPrice, cacheGeneration);
+        }
+        long long nowMillis = chrono::duration_cast<chrono::milliseconds>(
+            chrono::system_clock::now().time_since_epoch()).count();
+        time_t now = (time_t)(nowMillis / 1000);
+        double totalPrice = promotions.orderTotal(sold, unitPrice, orderQuantity, now);
+        logOrder(sequence, nowMillis, sold.id, orderQuantity, unitPrice, totalPrice);
+        journalOrder(sold, orderQuantity, totalPrice, now);
+        analytics.recordSale(sold, orderQuantity, totalPrice, now);
+        productsDirty = true;
+        return totalPrice;
+    }
+
+    // ----------------------- Order Log -----------------------
+    // orderlog.csv is the machine-readable twin of orders.csv, one row per
+    // sale: sequence,unix time (ms),product id,quantity,unit price,total.
+    // Sequence numbers come from the catalog version the sale produced, and
+    // every products.csv snapshot starts with "#sequence,<n>", the last sale
+    // it already contains. Snapshot + the log rows after n = current stock.
+    void logOrder(unsigned long long sequence, long long timeMillis, int id, int orderQuantity,
+        double unitPrice, double totalPrice) {
+        char row[160];
+        int length = snprintf(row, sizeof(row), "%llu,%lld,%d,%d,%.17g,%.17g\n",
+            sequence, timeMillis, id, orderQuantity, unitPrice, totalPrice);
+        orderLog.append(string(row, length));
+    }
+
+    // Apply the logged sales newer than the snapshot as one batched merge:
+    // quantities are summed per product first, then the tree is rebuilt once
+    // instead of being path-copied per sale. A snapshot without a sequence
+    // line (hand-made or from an older build) is taken as current: nothing
+    // is replayed, and it is re-saved with a sequence straight away.
+    void recoverFromOrderLog(unsigned long long snapshotSequence, bool replay) {
+        auto start = chrono::steady_clock::now();
+        lastReplay = ReplayStats{};
+        lastReplay.snapshotSequence = snapshotSequence;
+        unsigned long long lastSequence = snapshotSequence;
+        ifstream file(orderLogFile);
+        if (file) {
+            unordered_map<int, long long> unitsSold;
+            string line;
+            while (getline(file, line)) {
+                if (line.empty()) continue;
+                LoggedOrder order;
+                if (!parseLoggedOrder(line, order)) {
+                    lastReplay.malformed++;
+                    continue;
+                }
+                lastReplay.records++;
+                lastSequence = max(lastSequence, order.sequence);
+                if (!replay || order.sequence <= snapshotSequence)
+                    continue;
+                unitsSold[order.productId] += order.quantity;
+                lastReplay.replayed++;
+            }
+            file.close();
+
+            CatalogSnapshot catalog = productTree.snapshot();
+            vector<Product> changes;
+            for (const auto& sold : unitsSold) {
+                if (catalog.search(sold.first))
+                    changes.emplace_back(sold.first, "", "", 0.0, (int)sold.second);
+                else
+                    lastReplay.unknownProducts++;
+            }
+            sort(changes.begin(), changes.end());
+            if (!changes.empty()) {
+                productTree.bulkMerge(changes, [](Product& stored, const Product& sold) {
+                    stored.quantity -= sold.quantity;
+                });
+            }
+            lastReplay.productsTouched = changes.size();
+        }
+        productTree.restoreSequence(lastSequence);
+        lastReplay.lastSequence = lastSequence;
+        lastReplay.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (lastReplay.replayed > 0)
+            cout << "Replayed " << lastReplay.replayed << " logged sales onto the catalog snapshot.\n";
+        if (!replay && lastReplay.records > 0)
+            cout << productFile << " has no #sequence line; its " << lastReplay.records
+                << " order log rows were not replayed.\n";
+        if (lastReplay.replayed > 0 || !replay)
+            saveProductsToFile();
+        if (lastReplay.malformed > 0)
+            cout << "Skipped " << lastReplay.malformed << " malformed order log rows.\n";
+    }
+
+    // ----------------------- Admins -----------------------
+    void loadAdminsFromFile() {
+        ifstream file(adminFile);
+        if (!file) {
+            // If no admin file, create a default admin
+            admins.emplace_back("admin", "admin");
+            return;
+        }
+        string line;
+        while (getline(file, line)) {
+            if (line.empty()) continue;
+            vector<string> tokens = splitCSV(line);
+            if (tokens.size() != 2) {
+                cout << "Skipping malformed admin record: " << line << "\n";
+                continue;
+            }
+            admins.emplace_back(tokens[0], tokens[1]);
+        }
+        file.close();
+    }
+
+    void saveAdminsToFile() {
+        vector<pair<string, string>> records = admins;
+        checkpointer.schedule(adminFile, [records] {
+            ostringstream out;
+            for (const auto& admin : records) {
+                out << admin.first << "," << admin.second << "\n";
+            }
+            return out.str();
+        });
+    }
+
+    // ----------------------- Wishlist -----------------------
+    void loadWishlistFromFile() {
+        ifstream file(wishlistFile);
+        if (!file) return; // No wishlist file yet
+        string line;
+        while (getline(file, line)) {
+            if (line.empty()) continue;
+            Product product;
+            if (parseProductCSV(line, product))
+                wishlist.add(product);
+            else
+                cout << "Skipping malformed wishlist record: " << line << "\n";
+        }
+        file.close();
+    }
+
+    void saveWishlistToFile() {
+        vector<Product> products = wishlist.getAll();
+        checkpointer.schedule(wishlistFile, [products] {
+            return renderProducts(products);
+        });
+    }
+
+    // ----------------------- Promotions -----------------------
+    void loadPromotionsFromFile() {
+        ifstream file(promotionsFile);
+        if (!file) return; // No promotions yet
+        vector<Promotion> records;
+        string line;
+        while (getline(file, line)) {
+            if (line.empty()) continue;
+            Promotion promotion;
+            if (parseRecordCSV(line, promotion, promotionColumns))
+                records.push_back(promotion);
+            else
+                cout << "Skipping malformed promotion record: " << line << "\n";
+        }
+        file.close();
+        for (const auto& rejected : promotions.load(records))
+            cout << "Skipping promotion " << rejected.first.id << ": " << rejected.second << "\n";
+    }
+
+    void savePromotionsToFile() {
+        string rows = promotions.render();
+        checkpointer.schedule(promotionsFile, [rows] {
+            return rows;
+        });
+    }
+
+    // ----------------------- Other Functions -----------------------
+    void addToWishlist() {
+        int id;
+        cout << "\nEnter Product ID to add to wishlist: ";
+        while (!getValidatedInteger(id)) {
+            cout << "Invalid input ID: ";
+        }
+        const Product* product = productTree.search(id);
+        if (product) {
+            wishlist.add(*product);
+            cout << "\nProduct added to wishlist successfully.\n";
+            saveWishlistToFile();
+        }
+        else {
+            cout << "\nProduct not found.\n";
+        }
+    }
+
+    void viewWishlist() {
+        vector<Product> products = wishlist.getAll();
+        if (products.empty()) {
+            cout << "\nYour wishlist is empty.\n";
+            return;
+        }
+        cout << "\nYour Wishlist:\n";
+        cout << left << setw(10) << "ID" << setw(20) << "Name"
+            << setw(20) << "Category" << setw(10) << "Price"
+            << setw(10) << "Qty" << setw(10) << "Discount"
+            << setw(10) << "Tax" << setw(15) << "Expiry Date" << "\n";
+        cout << string(105, '-') << "\n";
+        for (const auto& product : products) {
+            cout << left << setw(10) << product.id
+                << setw(20) << product.name
+                << setw(20) << product.category
+                << setw(10) << fixed << setprecision(2) << product.price
+                << setw(10) << product.quantity
+                << setw(10) << product.discount << "%"
+                << setw(10) << product.tax << "%"
+                << setw(15) << product.Date << "\n";
+        }
+    }
+
+    // Customer places order (cart functionality removed)
+    void checkout() {
+        placeOrder();
+    }
+
+    void viewTotalInventoryValue() {
+        double totalValue = inventoryValue(productTree.snapshot());
+        cout << "\nTotal Inventory Value: Rs." << fixed << setprecision(2) << totalValue << "\n";
+    }
+
+    void sortProducts() {
+        cout << "\nSort by (comma separated: id, price, quantity, category, expiry, final;\n"
+            << "prefix '-' for descending, e.g. category,-price): ";
+        string text;
+        getline(cin, text);
+        vector<SortField> fields;
+        if (!parseSortFields(text, fields)) {
+            cout << "\nUnknown sort key.\n";
+            return;
+        }
+        int limit;
+        cout << "How many rows to show (0 for all): ";
+        while (!getValidatedInteger(limit) || limit < 0) {
+            cout << "Invalid input. Please enter 0 or a positive number: ";
+        }
+
+        bool cached = false;
+        auto start = chrono::steady_clock::now();
+        auto view = sorter.view(productTree.snapshot(), fields, &cached);
+        double elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (view->size() == 0) {
+            cout << "\nNo products available.\n";
+            return;
+        }
+        size_t shown = limit == 0 ? view->size() : min(view->size(), (size_t)limit);
+        printProductTableHeader();
+        for (size_t i = 0; i < shown; i++)
+            printProductTableRow((*view)[i]);
+        cout << "\nShowing " << shown << " of " << view->size() << " products ("
+            << (cached ? "cached order, " : "sorted in ") << fixed << setprecision(2)
+            << elapsedMs << " ms).\n";
+    }
+
+    void generateReport() {
+        ofstream report("report.csv");
+        if (!report) {
+            cout << "\nError generating report.\n";
+            return;
+        }
+        // Write header row in CSV format
+        string rows = productCSVHeader();
+        productTree.snapshot().forEach([&](const Product& product) {
+            appendProductCSV<CsvStyle::Report>(rows, product);
+            });
+        report << rows;
+        cout << "\nReport generated successfully in 'report.csv'.\n";
+    }
+
+    // A number looks up that ID; anything else is a fuzzy name search
+    void searchProduct() {
+        string text;
+        cout << "\nEnter product ID or name to search: ";
+        getline(cin, text);
+        int id;
+        auto parsed = from_chars(text.data(), text.data() + text.size(), id);
+        if (parsed.ec != errc() || parsed.ptr != text.data() + text.size()) {
+            findProducts(text);
+            return;
+        }
+        const Product* product = productTree.search(id);
+        if (product) {
+            cout << "\nProduct Found:\n";
+            cout << "ID: " << product->id << "\n";
+            cout << "Name: " << product->name << "\n";
+            cout << "Category: " << product->category << "\n";
+            cout << "Price: " << product->price << "\n";
+            cout << "Quantity: " << product->quantity << "\n";
+            cout << "Discount: " << product->discount << "%\n";
+            cout << "Tax: " << product->tax << "%\n";
+            cout << "Date: " << product->Date << "\n";
+        }
+        else {
+            cout << "\nProduct not found.\n";
+        }
+    }
+
+    void findProducts(string query = "") {
+        while (SearchIndex::tokenize(query).empty()) {
+            cout << "\nEnter product name or category to search: ";
+            getline(cin, query);
+            if (!cin) return;
+        }
+        const size_t limit = 10;
+        auto start = chrono::steady_clock::now();
+        vector<SearchIndex::Match> matches = searchIndex.search(query, limit);
+        double elapsedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        CatalogSnapshot catalog = productTree.snapshot();
+        if (matches.empty()) {
+            cout << "\nNo matching products.\n";
+            return;
+        }
+        cout << "\nBest matches for \"" << query << "\":\n";
+        printProductTableHeader();
+        for (const auto& match : matches) {
+            if (const Product* product = catalog.search(match.id))
+                printProductTableRow(*product);
+        }
+        cout << "\n" << matches.size() << " matches (" << fixed << setprecision(2) << elapsedMs << " ms).\n";
+    }
+
+    void deleteProduct() {
+        int id;
+        cout << "\nEnter product ID to delete: ";
+        while (!getValidatedInteger(id)) {
+            cout << "Invalid input ID. Please try again: ";
+        }
+
+        // The hold check runs under the catalog write lock, where holds are
+        // placed, so none can be placed between the check and the delete
+        reservations.expireDue();
+        bool found = false, held = false;
+        Product removed;
+        productTree.deleteIf(id, [&](const Product& product) {
+            found = true;
+            held = reservations.reservedUnits(id) > 0;
+            removed = product;
+            return !held;
+        });
+        if (held) {
+            cout << "\nProduct has units on hold; release or confirm the holds first.\n";
+        }
+        else if (found) {
+            searchIndex.remove(removed);
+            priceCache.invalidate(id);
+            cout << "\nProduct deleted successfully.\n";
+            saveProductsToFile(); // Update the CSV file after deletion
+        }
+        else {
+            cout << "\nProduct not found.\n";
+        }
+    }
+
+    // Modified modifyProduct function with an option to add additional quantity.
+    void modifyProduct() {
+        int id;
+        cout << "\nEnter Product ID to modify: ";
+        while (!getValidatedInteger(id)) {
+            cout << "Invalid input for Product ID. Please try again: ";
+        }
+
+        const Product* found = productTree.search(id);
+        if (found) {
+            // Only collect the new values here: sales keep running while the
+            // admin types, so the stock level is re-read when they are applied
+            int currentQuantity = found->quantity;
+            cout << "\nEnter new details for the product:\n";
+
+            // Get and validate the new name
+            string newName;
+            cout << "Name: ";
+            while (!getValidatedString(newName, true)) {
+                cout << "Invalid input for Name. Please try again: ";
+            }
+
+            // Get and validate the new category
+            string newCategory;
+            cout << "Category: ";
+            while (!getValidatedString(newCategory, true)) {
+                cout << "Invalid input for Category. Please try again: ";
+            }
+
+            // Get and validate the new price
+            double newPrice;
+            cout << "Price: ";
+            while (!getValidatedDouble(newPrice)) {
+                cout << "Invalid input for Price. Please try again: ";
+            }
+
+            // Show current quantity and get additional quantity to add
+            cout << "Current Quantity: " << currentQuantity << "\n";
+            int addQty;
+            cout << "Enter quantity to add (enter 0 if no change): ";
+            while (!getValidatedInteger(addQty)) {
+                cout << "Invalid input for Quantity. Please try again: ";
+            }
+
+            // Get and validate the new discount
+            double newDiscount;
+            cout << "Enter Discount (%): ";
+            while (!getValidatedDouble(newDiscount)) {
+                cout << "Invalid input for Discount. Please try again: ";
+            }
+
+            // Get and validate the new tax
+            double newTax;
+            cout << "Enter Tax (%): ";
+            while (!getValidatedDouble(newTax)) {
+                cout << "Invalid input for Tax. Please try again: ";
+            }
+
+            // Get and validate the new date
+            string newDate;
+            cout << "Date (YYYY-MM-DD): ";
+            // Ensure any leftover newline is consumed
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            while (true) {
+                getline(cin, newDate);
+                if (isValidDate(newDate)) {   // Assumes isValidDate() is defined elsewhere.
+                    break;
+                }
+                else {
+                    cout << "Invalid date format. Please try again (YYYY-MM-DD): ";
+                }
+            }
+
+            // Apply the new fields and the quantity change to whatever version
+            // is current, so sales made meanwhile are kept
+            Product before, after;
+            long long held = 0;
+            bool belowHeld = false;
+            reservations.expireDue();
+            bool modified = productTree.update(id, [&](Product& product) {
+                held = reservations.reservedUnits(id);
+                if (product.quantity + addQty < held) {
+                    belowHeld = true;
+                    return false;
+                }
+                before = product;
+                product.name = newName;
+                product.category = newCategory;
+                product.price = newPrice;
+                product.quantity += addQty;
+                product.discount = newDiscount;
+                product.tax = newTax;
+                product.Date = newDate;
+                after = product;
+                return true;
+            });
+            if (belowHeld) {
+                cout << "\n" << held << " units are on hold; quantity cannot go below that. Product not modified.\n";
+            }
+            else if (!modified) {
+                cout << "\nProduct was deleted meanwhile.\n";
+            }
+            else {
+                searchIndex.update(before, after);
+                priceCache.invalidate(id);
+                cout << "\nProduct modified successfully.\n";
+                saveProductsToFile();
+            }
+        }
+        else {
+            cout << "\nProduct not found.\n";
+        }
+    }
+
+    void addProduct() {
+        int id;
+        string name, category, Date;
+        double price, discount, tax;
+        int quantity;
+
+        cout << "\nEnter Product ID: ";
+        while (!getValidatedInteger(id)) {
+            cout << "Invalid input for product ID: ";
+        }
+        if (productTree.search(id)) {
+            cout << "\nA product with this ID already exists. Use Modify Product instead.\n";
+            return;
+        }
+
+        cout << "Enter Product Name: ";
+        // Use getline to get the full name (allows spaces)
+        while (!getValidatedString(name, true)) {
+            cout << "Invalid input for name: ";
+        }
+
+        cout << "Enter Product Category: ";
+        while (!getValidatedString(category, true)) {
+            cout << "Invalid input for category: ";
+        }
+
+        cout << "Enter Product Price: ";
+        while (!getValidatedDouble(price) || price < 0) {
+            cout << "Invalid input for Price: ";
+        }
+
+        cout << "Enter Product Quantity: ";
+        while (!getValidatedInteger(quantity) || quantity < 0) {
+            cout << "Invalid input for Quantity: ";
+        }
+
+        cout << "Enter Discount (%): ";
+        while (!getValidatedDouble(discount) || discount < 0 || discount > 100) {
+            cout << "Invalid input for Discount: ";
+        }
+
+        cout << "Enter Tax (%): ";
+        while (!getValidatedDouble(tax) || tax < 0 || tax > 100) {
+            cout << "Invalid input for Tax: ";
+        }
+
+        while (true) {
+            cout << "Enter Date (YYYY-MM-DD): ";
+            getline(cin, Date);
+
+            if (isValidDate(Date)) {
+                cout << "Valid date entered: " << Date << endl;
+                break;  // Exit the loop if the date is valid
+            }
+            else {
+                cout << "Invalid date format. Please try again." << endl;
+            }
+        }
+
+        Product product(id, name, category, price, quantity, Date, discount, tax);
+        if (!productTree.insert(product)) {
+            cout << "\nA product with this ID already exists.\n";
+            return;
+        }
+        searchIndex.add(product);
+        cout << "\nProduct added successfully.\n";
+        saveProductsToFile();
+    }
+
+    void bulkImportProducts() {
+        string path;
+        cout << "\nEnter supplier CSV file path: ";
+        getline(cin, path);
+        ImportSummary summary;
+        if (!importProducts(path, summary)) {
+            cout << "\nCould not open '" << path << "'.\n";
+            return;
+        }
+        cout << "\nBulk import complete.\n";
+        cout << "New products added:       " << summary.added << "\n";
+        cout << "Existing products merged: " << summary.merged << "\n";
+        cout << "Rows rejected:            " << summary.rejected() << "\n";
+        cout << "  Duplicate IDs:          " << summary.duplicates << "\n";
+        cout << "  Malformed rows:         " << summary.malformed << "\n";
+        cout << "  Invalid values:         " << summary.invalid << "\n";
+        cout << "  Stock below held/zero:  " << summary.stockShort << "\n";
+    }
+
+    void showSalesAnalytics() {
+        int count;
+        cout << "\nHow many top products to show: ";
+        while (!getValidatedInteger(count) || count < 1) {
+            cout << "Invalid input. Please enter a positive number: ";
+        }
+        SalesAnalytics::Bucket totals = analytics.totals();
+        cout << "\nSales Analytics\n";
+        cout << "----------------------------------------\n";
+        cout << "Units sold: " << totals.units
+            << "   Revenue: Rs." << fixed << setprecision(2) << totals.revenue << "\n";
+
+        auto printRanking = [](const string& title, const vector<SalesAnalytics::ProductSales>& ranking) {
+            cout << "\n" << title << ":\n";
+            cout << left << setw(10) << "ID" << setw(20) << "Name"
+                << setw(20) << "Category" << setw(10) << "Units" << setw(15) << "Revenue" << "\n";
+            cout << string(75, '-') << "\n";
+            for (const auto& sales : ranking) {
+                cout << left << setw(10) << sales.id << setw(20) << sales.name
+                    << setw(20) << sales.category << setw(10) << sales.units
+                    << fixed << setprecision(2) << sales.revenue << "\n";
+            }
+        };
+        printRanking("Top Products by Units", analytics.topByUnits(count));
+        printRanking("Top Products by Revenue", analytics.topByRevenue(count));
+
+        cout << "\nRevenue by Category:\n";
+        for (const auto& category : analytics.categoryRevenue()) {
+            cout << left << setw(20) << category.first
+                << "Rs." << fixed << setprecision(2) << category.second << "\n";
+        }
+
+        time_t now = time(nullptr);
+        cout << "\nHourly Sales (last 24 hours):\n";
+        for (const auto& hour : analytics.hourlySeries(now - 24 * 3600, now + 1)) {
+            tm local = toLocalTime((time_t)hour.first * 3600);
+            cout << "  " << put_time(&local, "%Y-%m-%d %H:00") << "   "
+                << setw(8) << hour.second.units << " units   Rs."
+                << fixed << setprecision(2) << hour.second.revenue << "\n";
+        }
+        cout << "\nDaily Sales (last 7 days):\n";
+        for (const auto& day : analytics.dailySeries(localDateKey(now - 6 * 86400), localDateKey(now))) {
+            cout << "  " << day.first / 10000 << "-" << setfill('0') << setw(2) << day.first / 100 % 100
+                << "-" << setw(2) << day.first % 100 << setfill(' ') << "   "
+                << setw(8) << day.second.units << " units   Rs."
+                << fixed << setprecision(2) << day.second.revenue << "\n";
+        }
+
+        HotPriceCache::Stats cache = priceCache.stats();
+        cout << "\nPrice cache: " << cache.hits << " hits, " << cache.misses << " misses ("
+            << fixed << setprecision(1) << cache.hitRatio() * 100 << "% hit ratio)\n";
+    }
+
+    void listPromotions() {
+        vector<Promotion> list = promotions.list();
+        if (list.empty()) {
+            cout << "\nNo promotions defined.\n";
+            return;
+        }
+        time_t now = time(nullptr);
+        cout << "\n" << left << setw(6) << "ID" << setw(10) << "Scope" << setw(16) << "Target"
+            << setw(22) << "Offer" << setw(18) << "Starts" << setw(18) << "Ends" << "Status\n";
+        cout << string(100, '-') << "\n";
+        for (const auto& promotion : list) {
+            PromotionRule rule;
+            string error;
+            compilePromotionRule(promotion, rule, error);
+            ostringstream offer;
+            if (rule.bundle)
+                offer << "buy " << rule.buy << " get " << rule.getFree << " free";
+            else
+                offer << rule.percentOff << "% off " << rule.minQuantity << "+ units";
+            cout << left << setw(6) << promotion.id << setw(10) << promotion.scope
+                << setw(16) << promotion.target << setw(22) << offer.str()
+                << setw(18) << (promotion.starts.empty() ? "-" : promotion.starts)
+                << setw(18) << (promotion.ends.empty() ? "-" : promotion.ends)
+                << (rule.activeAt(now) ? "active" : now < rule.starts ? "scheduled" : "expired") << "\n";
+        }
+    }
+
+    void addPromotion() {
+        Promotion promotion;
+        cout << "\nScope (product/category): ";
+        getline(cin, promotion.scope);
+        cout << (promotion.scope == "product" ? "Product ID: " : "Category: ");
+        getline(cin, promotion.target);
+        cout << "Type (percent/bxgy): ";
+        getline(cin, promotion.type);
+        if (promotion.type == "bxgy") {
+            cout << "Buy: ";
+            while (!getValidatedInteger(promotion.buy)) {
+                cout << "Invalid input. Please enter a number: ";
+            }
+            cout << "Get Free: ";
+            while (!getValidatedInteger(promotion.getFree)) {
+                cout << "Invalid input. Please enter a number: ";
+            }
+        }
+        else {
+            cout << "Percent Off: ";
+            while (!getValidatedDouble(promotion.percentOff)) {
+                cout << "Invalid input. Please enter a number: ";
+            }
+            cout << "Min Quantity (1 for every order): ";
+            while (!getValidatedInteger(promotion.minQuantity)) {
+                cout << "Invalid input. Please enter a number: ";
+            }
+        }
+        cout << "Starts (YYYY-MM-DD HH:MM, blank for now): ";
+        getline(cin, promotion.starts);
+        cout << "Ends (YYYY-MM-DD HH:MM, blank for never): ";
+        getline(cin, promotion.ends);
+
+        string error;
+        if (!promotions.add(promotion, error)) {
+            cout << "\nPromotion not added: " << error << ".\n";
+            return;
+        }
+        savePromotionsToFile();
+        cout << "\nPromotion added successfully.\n";
+    }
+
+    void removePromotion() {
+        int id;
+        cout << "\nEnter promotion ID to remove: ";
+        while (!getValidatedInteger(id)) {
+            cout << "Invalid input ID. Please try again: ";
+        }
+        if (!promotions.remove(id)) {
+            cout << "\nPromotion not found.\n";
+            return;
+        }
+        savePromotionsToFile();
+        cout << "\nPromotion removed successfully.\n";
+    }
+
+    void managePromotions() {
+        int choice;
+        do {
+            cout << "\nPromotions\n";
+            cout << "1. List Promotions\n";
+            cout << "2. Add Promotion\n";
+            cout << "3. Remove Promotion\n";
+            cout << "4. Back\n";
+            while (true) {
+                cout << "Enter your choice: ";
+                if (getValidatedInteger(choice)) {
+                    break;
+                }
+                cout << "Invalid input. Please enter a valid number.\n";
+            }
+            switch (choice) {
+            case 1: listPromotions(); break;
+            case 2: addPromotion(); break;
+            case 3: removePromotion(); break;
+            case 4: break;
+            default: cout << "\nInvalid choice. Please try again.\n";
+            }
+        } while (choice != 4);
+    }
+
+    void showAvailableProducts() {
+        // Pin one version so a concurrent sale cannot change the listing mid-print
+        vector<Product> products = productTree.snapshot().getAllProducts();
+        if (products.empty()) {
+            cout << "\nNo products available.\n";
+            return;
+        }
+        cout << "\nAvailable Products:\n";
+        printProductTableHeader();
+        for (const auto& product : products)
+            printProductTableRow(product);
+    }
+
+    static void printProductTableHeader() {
+        cout << left << setw(10) << "ID" << setw(20) << "Name"
+            << setw(20) << "Category" << setw(10) << "Price"
+            << setw(10) << "Qty" << setw(10) << "Discount"
+            << setw(10) << "Tax" << setw(15) << "Date" << "\n";
+        cout << string(105, '-') << "\n";
+    }
+
+    static void printProductTableRow(const Product& product) {
+        cout << left << setw(10) << product.id
+            << setw(20) << product.name
+            << setw(20) << product.category
+            << setw(10) << fixed << setprecision(2) << product.price
+            << setw(10) << product.quantity
+            << setw(10) << product.discount << "%"  // Percentage sign for discount
+            << setw(10) << product.tax << "%"       // Percentage sign for tax
+            << setw(15) << product.Date << "\n";    // No percentage sign for date
+    }
+    void addAdmin() {
+        string username, password;
+        cout << "\nEnter New Admin Username: ";
+        while (true) {
+            if (getValidatedString(username)) {
+                break;
+            }
+            cout << "Invalid input for username. Please try again: ";
+        }
+        cout << "Enter New Admin Password: ";
+        while (true) {
+            if (getValidatedString(password)) {
+                break;
+            }
+            cout << "Invalid input for password. Please try again: ";
+        }
+        admins.emplace_back(username, password);
+        cout << "\nAdmin added successfully.\n";
+        saveAdminsToFile();
+    }
+
+    void placeOrder() {
+        int id;
+        int orderQuantity;
+        cout << "\nEnter Product ID to order: ";
+        while (!getValidatedInteger(id)) {
+            cout << "Invalid input. Please enter a valid product ID: ";
+        }
+        const Product* product = productTree.search(id);
+        if (product) {
+            cout << "Enter Quantity to order: ";
+            while (!getValidatedInteger(orderQuantity)) {
+                cout << "Invalid input. Please enter a valid quantity: ";
+            }
+            double totalPrice = 0;
+            switch (processOrder(id, orderQuantity, totalPrice)) {
+            case OrderStatus::Placed:
+                if (!flushChanges()) {
+                    cout << "\nOrder could not be recorded. Please contact an administrator.\n";
+                    break;
+                }
+                cout << "\nOrder placed successfully.\n";
+                cout << "Total Bill: Rs." << fixed << setprecision(2) << totalPrice << "\n";
+                break;
+            case OrderStatus::InvalidQuantity:
+                cout << "\nOrder quantity must be greater than zero.\n";
+                break;
+            case OrderStatus::InsufficientStock:
+                cout << "\nNot enough stock available. Order quantity exceeds available stock.\n";
+                break;
+            case OrderStatus::NotRecorded:
+                cout << "\nOrders cannot be recorded right now. Please contact an administrator.\n";
+                break;
+            case OrderStatus::NotFound:
+            case OrderStatus::NoHold:
+                cout << "\nProduct not found.\n";
+                break;
+            }
+        }
+        else {
+            cout << "\nProduct not found.\n";
+        }
+    }
+
+    // Modified checkLowStockLevels: if there are no products, show "No products available."
+    void checkLowStockLevels() {
+        vector<Product> products = productTree.snapshot().getAllProducts();
+        if (products.empty()) {
+            cout << "\nNo products available.\n";
+            return;
+        }
+        bool lowStockFound = false;
+        cout << "\nChecking for low stock levels...\n";
+        for (const auto& product : products) {
+            if (product.quantity < 20) {
+                cout << "Warning: Product ID " << product.id
+                    << " (" << product.name << ") has low stock. Current quantity: "
+                    << product.quantity << "\n";
+                lowStockFound = true;
+            }
+        }
+        if (!lowStockFound)
+            cout << "No products have low stock levels.\n";
+    }
+
+    // Queue one sale for orders.csv (made durable by flushChanges)
+    void journalOrder(const Product& product, int orderQuantity, double totalPrice, time_t when) {
+        tm local = toLocalTime(when);
+        ostringstream record;
+        record << "Product ID: " << product.id << "\n";
+        record << "Product Name: " << product.name << "\n";
+        record << "Quantity Ordered: " << orderQuantity << "\n";
+        record << "Total Price: Rs." << fixed << setprecision(2) << totalPrice << "\n";
+        record << "Order Time: " << put_time(&local, "%Y-%m-%d %H:%M:%S") << "\n\n";
+        orderJournal.append(record.str());
+    }
+
+    // Replay orders.csv into the analytics totals. Records are blank-line
+    // separated; ones written before order times were journaled have none.
+    void loadSalesHistory() {
+        ifstream file(ordersFile);
+        if (!file) return;
+        CatalogSnapshot catalog = productTree.snapshot();
+        Product product;
+        int quantity = 0;
+        double totalPrice = 0;
+        time_t when = 0;
+        bool haveRecord = false;
+        auto finishRecord = [&] {
+            if (haveRecord && quantity > 0) {
+                const Product* current = catalog.search(product.id);
+                product.category = current ? current->category : "Unknown";
+                analytics.recordSale(product, quantity, totalPrice, when);
+            }
+            product = Product();
+            quantity = 0;
+            totalPrice = 0;
+            when = 0;
+            haveRecord = false;
+        };
+        string line;
+        while (getline(file, line)) {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            try {
+                if (line.rfind("Product ID: ", 0) == 0) {
+                    finishRecord();
+                    product.id = stoi(line.substr(12));
+                    haveRecord = true;
+                }
+                else if (line.rfind("Product Name: ", 0) == 0) {
+                    product.name = line.substr(14);
+                }
+                else if (line.rfind("Quantity Ordered: ", 0) == 0) {
+                    quantity = stoi(line.substr(18));
+                }
+                else if (line.rfind("Total Price: Rs.", 0) == 0) {
+                    totalPrice = stod(line.substr(16));
+                }
+                else if (line.rfind("Order Time: ", 0) == 0) {
+                    tm local{};
+                    istringstream(line.substr(12)) >> get_time(&local, "%Y-%m-%d %H:%M:%S");
+                    local.tm_isdst = -1;
+                    when = mktime(&local);
+                    if (when == (time_t)-1)
+                        when = 0;
+                }
+            }
+            catch (...) {
+                cout << "Skipping malformed order record near: " << line << "\n";
+                haveRecord = false;
+            }
+        }
+        finishRecord();
+    }
+
+public:
+    enum class OrderStatus { Placed, NotFound, InvalidQuantity, InsufficientStock, NoHold, NotRecorded };
+
+    // The checks Add Product applies to what it prompts for. Quantity is
+    // left to the caller: an import row adds it to existing stock.
+    static bool validProductFields(const Product& product) {
+        return product.price >= 0 && product.discount >= 0 && product.discount <= 100
+            && product.tax >= 0 && product.tax <= 100 && isValidDate(product.Date);
+    }
+
+    struct ImportSummary {
+        size_t added = 0;
+        size_t merged = 0;
+        size_t duplicates = 0;
+        size_t malformed = 0;
+        size_t invalid = 0;     // Bad price, discount, tax, date or new stock
+        size_t stockShort = 0;  // Merge would leave stock below zero or the held units
+        size_t rejected() const { return duplicates + malformed + invalid + stockShort; }
+    };
+
+    // Upsert a supplier CSV (same columns as products.csv) in one merge:
+    // new IDs are added, existing IDs take the supplier's details and have
+    // the supplied quantity added to their stock. Rows that fail Add
+    // Product's checks are refused, and so is a merge that would take stock
+    // below zero or below the units customers hold; both are decided under
+    // the catalog write lock so no sale or hold slips in between.
+    bool importProducts(const string& path, ImportSummary& summary) {
+        ifstream file(path);
+        if (!file)
+            return false;
+        vector<Product> incoming;
+        string line;
+        bool headerChecked = false;
+        while (getline(file, line)) {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line.empty()) continue;
+            Product product;
+            bool parsed = parseProductCSV(line, product);
+            if (!headerChecked && !parsed && !isdigit((unsigned char)line[0])) {
+                headerChecked = true;  // A non-numeric first line is taken as a header
+                continue;
+            }
+            headerChecked = true;
+            if (!parsed)
+                summary.malformed++;
+            else if (!validProductFields(product))
+                summary.invalid++;
+            else
+                incoming.push_back(product);
+        }
+        file.close();
+
+        summary.duplicates = sortAndRemoveDuplicates(incoming).size();
+        reservations.expireDue();  // Outside the catalog write lock
+        CatalogSnapshot before = productTree.snapshot();
+        productTree.bulkMergeIf(incoming, [&](const Product& supplied) {
+            if (supplied.quantity < 0) {
+                summary.invalid++;
+                return false;
+            }
+            summary.added++;
+            return true;
+        }, [&](Product& stored, const Product& supplied) {
+            long long stock = (long long)stored.quantity + supplied.quantity;
+            if (stock < 0 || stock > numeric_limits<int>::max() || stock < reservations.reservedUnits(stored.id)) {
+                summary.stockShort++;
+                return false;
+            }
+            stored = supplied;
+            stored.quantity = (int)stock;
+            summary.merged++;
+            return true;
+        });
+        CatalogSnapshot after = productTree.snapshot();
+        for (const auto& product : incoming) {
+            const Product* previous = before.search(product.id);
+            const Product* current = after.search(product.id);
+            if (!current)
+                continue;  // Refused new row
+            if (previous)
+                searchIndex.update(*previous, *current);
+            else
+                searchIndex.add(*current);
+        }
+        priceCache.invalidateAll();
+        saveProductsToFile();
+        return true;
+    }
+
+    // Stock logic shared by the customer menu and the order server.
+    // Decrements stock and journals the sale; callers decide when to
+    // persist (flushChanges) so the server can batch many orders per write.
+    // Units other customers hold are not available. No sale is taken while
+    // a journal has failed, since it could not be recorded.
+    OrderStatus processOrder(int id, int orderQuantity, double& totalPrice) {
+        if (orderQuantity <= 0)
+            return productTree.search(id) ? OrderStatus::InvalidQuantity : OrderStatus::NotFound;
+        if (!journalsHealthy())
+            return OrderStatus::NotRecorded;
+        reservations.expireDue();  // Outside the catalog write lock
+        uint64_t cacheGeneration = priceCache.generation();
+        OrderStatus status = OrderStatus::NotFound;
+        Product sold;
+        unsigned long long sequence = 0;
+        productTree.updateLogged(id, [&](Product& product) {
+            if (orderQuantity > product.quantity - reservations.reservedUnits(id)) {
+                status = OrderStatus::InsufficientStock;
+                return false;
+            }
+            product.quantity -= orderQuantity;
+            sold = product;
+            status = OrderStatus::Placed;
+            return true;
+        }, sequence);
+        if (status == OrderStatus::Placed)
+            totalPrice = recordSale(sold, orderQuantity, sequence, cacheGeneration);
+        return status;
+    }
+
+    // Set units aside for ttl; the hold id is what CONFIRM/RELEASE take
+    OrderStatus holdStock(int id, int quantity, chrono::seconds ttl, unsigned long long& holdId) {
+        if (quantity <= 0)
+            return productTree.search(id) ? OrderStatus::InvalidQuantity : OrderStatus::NotFound;
+        OrderStatus status = OrderStatus::NotFound;
+        reservations.expireDue();
+        // Runs under the catalog write lock so no sale changes the stock
+        // between the check and the hold; the edit itself is abandoned
+        productTree.update(id, [&](Product& product) {
+            status = reservations.place(id, quantity, product.quantity, ttl, holdId)
+                ? OrderStatus::Placed : OrderStatus::InsufficientStock;
+            return false;
+        });
+        return status;
+    }
+
+    // Turn a live hold into a sale of its units
+    OrderStatus confirmHold(unsigned long long holdId, double& totalPrice) {
+        ReservationBook::Hold hold;
+        if (!reservations.find(holdId, hold))
+            return OrderStatus::NoHold;
+        if (!journalsHealthy())
+            return OrderStatus::NotRecorded;
+        uint64_t cacheGeneration = priceCache.generation();
+        OrderStatus status = OrderStatus::NoHold;
+        Product sold;
+        unsigned long long sequence = 0;
+        bool productFound = false;
+        productTree.updateLogged(hold.productId, [&](Product& product) {
+            productFound = true;
+            if (!reservations.take(holdId, hold))
+                return false;  // Expired or released since the lookup
+            if (product.quantity < hold.quantity) {
+                status = OrderStatus::InsufficientStock;  // The hold is dropped
+                return false;
+            }
+            product.quantity -= hold.quantity;
+            sold = product;
+            status = OrderStatus::Placed;
+            return true;
+        }, sequence);
+        if (!productFound) {
+            reservations.release(holdId);  // Product deleted since: the hold cannot be sold
+            return OrderStatus::NotFound;
+        }
+        if (status == OrderStatus::Placed)
+            totalPrice = recordSale(sold, hold.quantity, sequence, cacheGeneration);
+        return status;
+    }
+
+    bool releaseHold(unsigned long long holdId) {
+        return reservations.release(holdId);
+    }
+
+    // Stock not held by anyone, and the units that are held
+    bool availability(int id, int& available, long long& held) {
+        reservations.expireDue();
+        CatalogSnapshot catalog = productTree.snapshot();
+        const Product* product = catalog.search(id);
+        if (!product)
+            return false;
+        held = reservations.reservedUnits(id);
+        available = (int)(product->quantity - held);
+        return true;
+    }
+
+    void numberHolds(unsigned long long first, unsigned long long step) {
+        reservations.numberHolds(first, step);
+    }
+
+    ReservationBook::Stats reservationStats() {
+        return reservations.stats();
+    }
+
+    const ReplayStats& replayStats() const {
+        return lastReplay;
+    }
+
+    double journalRecordsPerWrite() {
+        return orderJournal.recordsPerBatch();
+    }
+
+    HotPriceCache::Stats priceCacheStats() const {
+        return priceCache.stats();
+    }
+
+    CatalogSnapshot catalogSnapshot() const {
+        return productTree.snapshot();
+    }
+
+    // Final unit price (discount and tax applied, before promotions), from
+    // the hot cache when possible; false if there is no such product
+    bool quotePrice(int id, double& unitPrice) {
+        if (priceCache.lookup(id, unitPrice))
+            return true;
+        uint64_t cacheGeneration = priceCache.generation();
+        CatalogSnapshot catalog = productTree.snapshot();
+        const Product* product = catalog.search(id);
+        if (!product)
+            return false;
+        unitPrice = finalUnitPrice(*product);
+        priceCache.store(id, unitPrice, cacheGeneration);
+        return true;
+    }
+
+    bool lookupProduct(int id, Product& result) {
+        CatalogSnapshot catalog = productTree.snapshot();
+        const Product* product = catalog.search(id);
+        if (!product)
+            return false;
+        result = *product;
+        return true;
+    }
+
+    // Print what the background writers could not save. They never write to
+    // the console themselves, so their messages cannot land inside a menu.
+    void reportPersistenceErrors() {
+        for (const auto& failure : checkpointer.takeFailures())
+            cout << "\n" << failure << "\n";
+        unsigned long long failed = orderJournal.takeFailedWrites() + orderLog.takeFailedWrites();
+        if (failed > 0)
+            cout << "\nError writing order journal (" << failed << " failed writes).\n";
+    }
+
+    bool journalsHealthy() {
+        return orderLog.healthy() && orderJournal.healthy();
+    }
+
+    // Wait for the journals as far as the durability level asks, then queue a
+    // catalog checkpoint if anything changed. False if a sale made since the
+    // last call may not have been recorded.
+    bool flushChanges() {
+        bool logged = orderLog.waitUntilDurable(orderLog.lastAppended());
+        bool journaled = orderJournal.waitUntilDurable(orderJournal.lastAppended());
+        if (productsDirty.exchange(false))
+            saveProductsToFile();
+        reportPersistenceErrors();
+        return logged && journaled;
+    }
+
+    explicit PointOfSaleSystem(const string& fileSuffix = "",
+        Durability durability = persistenceOptions.durability,
+        bool journalIoThread = persistenceOptions.journalIoThread)
+        : shardWorker(!fileSuffix.empty()),
+        productFile("products" + fileSuffix + ".csv"),
+        adminFile("admins" + fileSuffix + ".csv"),
+        ordersFile("orders" + fileSuffix + ".csv"),
+        wishlistFile("wishlist" + fileSuffix + ".csv"),
+        promotionsFile("promotions.csv"),
+        orderLogFile("orderlog" + fileSuffix + ".csv"),
+        // Recovery reads the order log, so only it needs fsync; the
+        // receipts in orders.csv never wait for more than a write
+        orderJournal(ordersFile, min(durability, Durability::Written), journalIoThread),
+        orderLog(orderLogFile, durability, journalIoThread) {
+        if (!shardWorker)
+            loadAdminsFromFile();
+        loadProductsFromFile();
+        if (!shardWorker)
+            loadWishlistFromFile();
+        loadPromotionsFromFile();
+        loadSalesHistory();
+    }
+
+    ~PointOfSaleSystem() {
+        if (!shardWorker) {
+            saveAdminsToFile();
+            saveWishlistToFile();
+        }
+        saveProductsToFile();
+        checkpointer.waitUntilIdle();
+        reportPersistenceErrors();
+    }
+
+    void showHeader() {
+        cout << "=============================================" << endl;
+        cout << "   RIPHAH INTERNATIONAL UNIVERSITY SAHIWAL   " << endl;
+        cout << "=============================================" << endl;
+        cout << "\n---------------------------------------------" << endl;
+        cout << "            E-Sales Terminal:)              " << endl;
+        cout << "---------------------------------------------" << endl;
+        cout << "   1. Admin.                                 " << endl;
+        cout << "   2. Customer.                              " << endl;
+        cout << "   3. Exit.                                  " << endl;
+        cout << "---------------------------------------------" << endl;
+    }
+
+    bool login() {
+        string username, password;
+        // This loop will keep asking for valid credentials
+        while (true) {
+            cout << "Enter admin username: ";
+            while (!getValidatedString(username)) {
+                cout << "Invalid input for username. Please try again: ";
+            }
+
+            cout << "Enter admin password: ";
+            while (!getValidatedString(password)) {
+                cout << "Invalid input for password. Please try again: ";
+            }
+
+            // Check credentials
+            for (const auto& admin : admins) {
+                if (admin.first == username && admin.second == password) {
+                    cout << "\nSuccessfully logged in!\n";
+                    return true;
+                }
+            }
+            cout << "\nAccess denied. Invalid username or password. Please try again.\n";
         }
     }
 
     void adminMenu() {
         int choice;
         do {
+            reportPersistenceErrors();
             cout << "\nAdmin Menu\n";
             cout << "----------------------------------------" << endl;
             cout << "1. Add Product\n";
@@ -925,100 +4354,2569 @@ public:
             cout << "4. Delete Product\n";
             cout << "5. Add Admin\n";
             cout << "6. Search Product\n";
-            cout << "7. Sort Products by ID\n";
+            cout << "7. Sort Products\n";
             cout << "8. View Total Inventory Value\n";
             cout << "9. Generate Report\n";
             cout << "10. Check Low Stock Levels\n";
-            cout << "11. Exit\n";
+            cout << "11. Bulk Import Products\n";
+            cout << "12. Sales Analytics\n";
+            cout << "13. Manage Promotions\n";
+            cout << "14. Memory Usage Estimate\n";
+            cout << "15. Exit\n";
+
+            while (true) {
+                cout << "Enter your choice: ";
+                if (getValidatedInteger(choice)) {
+                    break;
+                }
+                cout << "Invalid input. Please enter a valid number.\n";
+            }
+
+            switch (choice) {
+            case 1: addProduct(); break;
+            case 2: showAvailableProducts(); break;
+            case 3: modifyProduct(); break;
+            case 4: deleteProduct(); break;
+            case 5: addAdmin(); break;
+            case 6: searchProduct(); break;
+            case 7: sortProducts(); break;
+            case 8: viewTotalInventoryValue(); break;
+            case 9: generateReport(); break;
+            case 10: checkLowStockLevels(); break;
+            case 11: bulkImportProducts(); break;
+            case 12: showSalesAnalytics(); break;
+            case 13: managePromotions(); break;
+            case 14: printMemoryReport(productTree.snapshot()); break;
+            case 15: cout << "\nExiting Admin Menu...\n"; break;
+            default: cout << "\nInvalid choice. Please try again.\n";
+            }
+        } while (choice != 15);
+    }
+
+    void customerMenu() {
+        int choice;
+        do {
+            reportPersistenceErrors();
+            cout << "\nCustomer Menu\n";
+            cout << "1. Place Order\n";
+            cout << "2. Show Available Products\n";
+            cout << "3. Add to Wishlist\n";
+            cout << "4. View Wishlist\n";
+            cout << "5. Search Products\n";
+            cout << "6. Exit\n";
+
+            while (true) {
+                cout << "Enter your choice: ";
+                if (getValidatedInteger(choice)) {
+                    break;
+                }
+                cout << "Invalid input. Please enter a valid number.\n";
+            }
+
+            switch (choice) {
+            case 1: placeOrder(); break;
+            case 2: showAvailableProducts(); break;
+            case 3: addToWishlist(); break;
+            case 4: viewWishlist(); break;
+            case 5: findProducts(); break;
+            case 6: cout << "\nExiting Customer Menu...\n"; break;
+            default: cout << "\nInvalid choice. Please try again.\n";
+            }
+        } while (choice != 6);
+    }
+
+    void startProgram() {
+        int choice;
+        do {
+            reportPersistenceErrors();
+            showHeader();
+
+            while (true) {
+                cout << "Enter your choice: ";
+                if (getValidatedInteger(choice)) {
+                    break;
+                }
+                cout << "Invalid choice input. Please enter a valid number.\n";
+            }
+
+            switch (choice) {
+            case 1:
+                if (login()) {
+                    adminMenu();
+                }
+                break;
+            case 2:
+                customerMenu();
+                break;
+            case 3:
+                cout << "\nExiting Program... Goodbye!\n";
+                break;
+            default:
+                cout << "\nInvalid choice. Please try again.\n";
+            }
+        } while (choice != 3);
+    }
+};
+
+#ifdef __linux__
+// --------------------- Network Endpoints ---------------------
+// Endpoints are given as "unix:/path/to.sock" or "tcp:PORT" (localhost only).
+struct Endpoint {
+    bool isUnix = false;
+    string path;
+    int port = 0;
+};
+
+bool parseEndpoint(const string& spec, Endpoint& endpoint) {
+    if (spec.rfind("unix:", 0) == 0 && spec.size() > 5) {
+        endpoint.isUnix = true;
+        endpoint.path = spec.substr(5);
+        return endpoint.path.size() < sizeof(sockaddr_un::sun_path);
+    }
+    if (spec.rfind("tcp:", 0) == 0) {
+        try {
+            endpoint.port = stoi(spec.substr(4));
+        }
+        catch (...) {
+            return false;
+        }
+        return endpoint.port > 0 && endpoint.port < 65536;
+    }
+    return false;
+}
+
+bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+int listenOnEndpoint(const Endpoint& endpoint) {
+    int fd = socket(endpoint.isUnix ? AF_UNIX : AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    int result;
+    if (endpoint.isUnix) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, endpoint.path.c_str(), sizeof(addr.sun_path) - 1);
+        unlink(endpoint.path.c_str());  // Remove a stale socket from a previous run
+        result = bind(fd, (sockaddr*)&addr, sizeof(addr));
+    }
+    else {
+        int yes = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(endpoint.port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        result = bind(fd, (sockaddr*)&addr, sizeof(addr));
+    }
+    if (result < 0 || listen(fd, SOMAXCONN) < 0 || !setNonBlocking(fd)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int connectToEndpoint(const Endpoint& endpoint) {
+    int fd = socket(endpoint.isUnix ? AF_UNIX : AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    int result;
+    if (endpoint.isUnix) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, endpoint.path.c_str(), sizeof(addr.sun_path) - 1);
+        result = connect(fd, (sockaddr*)&addr, sizeof(addr));
+    }
+    else {
+        int yes = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(endpoint.port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        result = connect(fd, (sockaddr*)&addr, sizeof(addr));
+    }
+    if (result < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Parse a decimal integer and advance past it; false if none is present or
+// it lies outside [low, high] (by default the range of int)
+bool parseIntToken(const char*& p, long& value,
+    long low = numeric_limits<int>::min(), long high = numeric_limits<int>::max()) {
+    while (*p == ' ' || *p == '\t')
+        ++p;
+    char* end;
+    errno = 0;
+    value = strtol(p, &end, 10);
+    if (end == p || errno == ERANGE || value < low || value > high)
+        return false;
+    p = end;
+    return true;
+}
+
+// True if only whitespace is left on the request line
+bool atLineEnd(const char* p) {
+    while (*p == ' ' || *p == '\t')
+        ++p;
+    return *p == '\0';
+}
+
+// A request that is one word, e.g. "VALUE", allowing trailing whitespace
+bool isBareCommand(const char* line, const char* command) {
+    size_t length = strlen(command);
+    return strncmp(line, command, length) == 0 && atLineEnd(line + length);
+}
+
+// Append everything the socket has ready to input.
+// Returns false on end of file or a hard error.
+bool readAvailable(int fd, string& input) {
+    char buffer[16384];
+    while (true) {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n > 0) {
+            input.append(buffer, n);
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return true;
+        if (n < 0 && errno == EINTR)
+            continue;
+        return false;
+    }
+}
+
+// Pending output for one non-blocking socket registered with epoll
+struct OutputBuffer {
+    string data;
+    size_t written = 0;
+    bool wantWrite = false;
+
+    // Send as much as the socket accepts. EPOLLOUT interest is kept only
+    // while something is left over. Returns false on a write error.
+    bool flush(int epollFd, int fd, epoll_data_t tag) {
+        while (written < data.size()) {
+            ssize_t n = send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+            if (n > 0) {
+                written += n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                break;
+            return false;
+        }
+        if (written == data.size()) {
+            data.clear();
+            written = 0;
+        }
+        bool pending = !data.empty();
+        if (pending != wantWrite) {
+            epoll_event ev{};
+            ev.events = EPOLLIN | (pending ? (uint32_t)EPOLLOUT : 0u);
+            ev.data = tag;
+            epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev);
+            wantWrite = pending;
+        }
+        return true;
+    }
+};
+
+// --------------------- Shard Map ---------------------
+// How product IDs are partitioned across shard worker processes. Each worker
+// is an ordinary order server with its own products.shard<N>.csv and
+// orders.shard<N>.csv. The layout is kept in shards.csv as either
+//   hash,<count>
+//   range,<count>,<first id of shard 1>,...,<first id of shard count-1>
+class ShardMap {
+private:
+    bool byRange = false;
+    int count = 1;
+    vector<int> boundaries;  // Range mode: first id owned by shards 1..count-1
+
+public:
+    static ShardMap hashed(int count) {
+        ShardMap map;
+        map.count = count;
+        return map;
+    }
+
+    // Split sorted ids into count ranges holding roughly equal numbers of products
+    static ShardMap ranged(const vector<int>& sortedIds, int count) {
+        ShardMap map;
+        map.byRange = true;
+        map.count = count;
+        for (int shard = 1; shard < count; shard++) {
+            size_t index = sortedIds.size() * shard / count;
+            int boundary = index < sortedIds.size() ? sortedIds[index] : numeric_limits<int>::max();
+            map.boundaries.push_back(max(boundary, map.boundaries.empty() ? boundary : map.boundaries.back()));
+        }
+        return map;
+    }
+
+    int shardFor(int id) const {
+        if (byRange)
+            return (int)(upper_bound(boundaries.begin(), boundaries.end(), id) - boundaries.begin());
+        // Multiplicative hash so consecutive ids spread over all shards
+        return (int)(((uint32_t)id * 2654435761u) % (uint32_t)count);
+    }
+
+    int shardCount() const {
+        return count;
+    }
+
+    static string fileSuffix(int shard) {
+        return ".shard" + to_string(shard);
+    }
+
+    static string endpointFor(int shard) {
+        return "unix:pos-shard" + to_string(shard) + ".sock";
+    }
+
+    bool save(const string& path) const {
+        string line = byRange ? "range," : "hash,";
+        line += to_string(count);
+        for (int boundary : boundaries)
+            line += "," + to_string(boundary);
+        return writeFileAtomically(path, line + "\n");
+    }
+
+    bool load(const string& path) {
+        ifstream file(path);
+        string line;
+        if (!file || !getline(file, line))
+            return false;
+        stringstream ss(line);
+        string kind, token;
+        getline(ss, kind, ',');
+        try {
+            if (!getline(ss, token, ','))
+                return false;
+            count = stoi(token);
+            boundaries.clear();
+            while (getline(ss, token, ','))
+                boundaries.push_back(stoi(token));
+        }
+        catch (...) {
+            return false;
+        }
+        byRange = (kind == "range");
+        if (count < 1 || (!byRange && kind != "hash"))
+            return false;
+        return !byRange || (int)boundaries.size() == count - 1;
+    }
+};
+
+// --------------------- Order Server ---------------------
+// Single-threaded epoll loop. Each request is one line of text; clients may
+// pipeline any number of requests and replies come back in the same order.
+//   ORDER <id> <qty>  ->  OK <total> | ERR NOT_FOUND | ERR OUT_OF_STOCK | ERR BAD_QUANTITY
+//   HOLD <id> <qty> [ttl seconds, default 300]  ->  HELD <hold id> | same errors as ORDER
+//   CONFIRM <hold id> ->  OK <total> | ERR NO_HOLD (unknown, released or expired)
+//   RELEASE <hold id> ->  RELEASED | ERR NO_HOLD
+//   AVAIL <id>        ->  AVAIL <available> <held> | ERR NOT_FOUND
+//   LOOKUP <id>       ->  PRODUCT id,name,category,price,qty,discount,tax,date | ERR NOT_FOUND
+//   QUOTE <id>        ->  PRICE <final unit price> | ERR NOT_FOUND  (served from the price cache)
+//   VALUE             ->  VALUE <inventory value> <units in stock> <product count>
+//   STATS             ->  STATS <price cache hits> <misses> <hit ratio>
+//   PING              ->  PONG
+// The journal for everything processed in one wakeup is flushed before its
+// replies are sent, and a single catalog checkpoint covers the whole batch.
+volatile sig_atomic_t serverStopRequested = 0;
+
+void requestServerStop(int) {
+    serverStopRequested = 1;
+}
+
+class OrderServer {
+private:
+    struct Connection {
+        string input;
+        OutputBuffer output;
+        vector<size_t> sales;  // Offsets in output of OK replies awaiting the flush
+    };
+
+    static const size_t maxLineLength = 4096;
+
+    PointOfSaleSystem& pos;
+    Endpoint endpoint;
+    int listenFd = -1;
+    int epollFd = -1;
+    unordered_map<int, Connection> connections;
+    unsigned long long requestsServed = 0;
+
+    void acceptClients() {
+        while (true) {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd < 0)
+                return;  // EAGAIN: backlog drained
+            setNonBlocking(fd);
+            if (!endpoint.isUnix) {
+                int yes = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+            }
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+            connections[fd];
+        }
+    }
+
+    void closeConnection(int fd) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        connections.erase(fd);
+    }
+
+    // Reply for a refused request, or for a sale with its total
+    static void appendOrderReply(PointOfSaleSystem::OrderStatus status, double totalPrice, string& output) {
+        char reply[64];
+        switch (status) {
+        case PointOfSaleSystem::OrderStatus::Placed:
+            snprintf(reply, sizeof(reply), "OK %.2f\n", totalPrice);
+            output += reply;
+            break;
+        case PointOfSaleSystem::OrderStatus::NotFound:
+            output += "ERR NOT_FOUND\n";
+            break;
+        case PointOfSaleSystem::OrderStatus::InvalidQuantity:
+            output += "ERR BAD_QUANTITY\n";
+            break;
+        case PointOfSaleSystem::OrderStatus::InsufficientStock:
+            output += "ERR OUT_OF_STOCK\n";
+            break;
+        case PointOfSaleSystem::OrderStatus::NoHold:
+            output += "ERR NO_HOLD\n";
+            break;
+        case PointOfSaleSystem::OrderStatus::NotRecorded:
+            output += "ERR NOT_RECORDED\n";
+            break;
+        }
+    }
+
+    // The flush failed: turn this batch's OK replies into errors
+    static void retractSales(Connection& conn) {
+        string& output = conn.output.data;
+        for (auto sale = conn.sales.rbegin(); sale != conn.sales.rend(); ++sale)
+            output.replace(*sale, output.find('\n', *sale) + 1 - *sale, "ERR NOT_RECORDED\n");
+    }
+
+    void handleRequest(const char* line, Connection& conn) {
+        string& output = conn.output.data;
+        char reply[128];
+        long id, quantity;
+        const char* p = line;
+        if (strncmp(line, "ORDER ", 6) == 0) {
+            p += 6;
+            if (!parseIntToken(p, id) || !parseIntToken(p, quantity) || !atLineEnd(p)) {
+                output += "ERR BAD_REQUEST\n";
+                return;
+            }
+            if (quantity <= 0) {
+                output += "ERR BAD_QUANTITY\n";
+                return;
+            }
+            double totalPrice = 0;
+            auto status = pos.processOrder((int)id, (int)quantity, totalPrice);
+            if (status == PointOfSaleSystem::OrderStatus::Placed)
+                conn.sales.push_back(output.size());
+            appendOrderReply(status, totalPrice, output);
+        }
+        else if (strncmp(line, "HOLD ", 5) == 0) {
+            p += 5;
+            long ttl = 300;
+            if (!parseIntToken(p, id) || !parseIntToken(p, quantity)
+                || (!atLineEnd(p) && !parseIntToken(p, ttl, 1, 86400)) || !atLineEnd(p)) {
+                output += "ERR BAD_REQUEST\n";
+                return;
+            }
+            if (quantity <= 0) {
+                output += "ERR BAD_QUANTITY\n";
+                return;
+            }
+            unsigned long long holdId = 0;
+            auto status = pos.holdStock((int)id, (int)quantity, chrono::seconds(ttl), holdId);
+            if (status == PointOfSaleSystem::OrderStatus::Placed) {
+                snprintf(reply, sizeof(reply), "HELD %llu\n", holdId);
+                output += reply;
+            }
+            else {
+                appendOrderReply(status, 0, output);
+            }
+        }
+        else if (strncmp(line, "CONFIRM ", 8) == 0 || strncmp(line, "RELEASE ", 8) == 0) {
+            p += 8;
+            long holdId;
+            if (!parseIntToken(p, holdId, 1, numeric_limits<long>::max()) || !atLineEnd(p)) {
+                output += "ERR BAD_REQUEST\n";
+            }
+            else if (line[0] == 'C') {
+                double totalPrice = 0;
+                auto status = pos.confirmHold((unsigned long long)holdId, totalPrice);
+                if (status == PointOfSaleSystem::OrderStatus::Placed)
+                    conn.sales.push_back(output.size());
+                appendOrderReply(status, totalPrice, output);
+            }
+            else {
+                output += pos.releaseHold((unsigned long long)holdId) ? "RELEASED\n" : "ERR NO_HOLD\n";
+            }
+        }
+        else if (strncmp(line, "AVAIL ", 6) == 0) {
+            p += 6;
+            int available;
+            long long held;
+            if (!parseIntToken(p, id) || !atLineEnd(p)) {
+                output += "ERR BAD_REQUEST\n";
+            }
+            else if (!pos.availability((int)id, available, held)) {
+                output += "ERR NOT_FOUND\n";
+            }
+            else {
+                snprintf(reply, sizeof(reply), "AVAIL %d %lld\n", available, held);
+                output += reply;
+            }
+        }
+        else if (strncmp(line, "LOOKUP ", 7) == 0) {
+            p += 7;
+            Product product;
+            if (!parseIntToken(p, id) || !atLineEnd(p)) {
+                output += "ERR BAD_REQUEST\n";
+            }
+            else if (!pos.lookupProduct((int)id, product)) {
+                output += "ERR NOT_FOUND\n";
+            }
+            else {
+                output += "PRODUCT ";
+                appendProductCSV<CsvStyle::Exact>(output, product);
+            }
+        }
+        else if (strncmp(line, "QUOTE ", 6) == 0) {
+            p += 6;
+            double unitPrice;
+            if (!parseIntToken(p, id) || !atLineEnd(p)) {
+                output += "ERR BAD_REQUEST\n";
+            }
+            else if (!pos.quotePrice((int)id, unitPrice)) {
+                output += "ERR NOT_FOUND\n";
+            }
+            else {
+                snprintf(reply, sizeof(reply), "PRICE %.2f\n", unitPrice);
+                output += reply;
+            }
+        }
+        else if (isBareCommand(line, "VALUE")) {
+            CatalogSnapshot catalog = pos.catalogSnapshot();
+            long long units = 0, products = 0;
+            catalog.forEach([&](const Product& product) {
+                units += product.quantity;
+                products++;
+            });
+            snprintf(reply, sizeof(reply), "VALUE %.2f %lld %lld\n",
+                inventoryValue(catalog), units, products);
+            output += reply;
+        }
+        else if (isBareCommand(line, "STATS")) {
+            HotPriceCache::Stats cache = pos.priceCacheStats();
+            snprintf(reply, sizeof(reply), "STATS %llu %llu %.4f\n",
+                (unsigned long long)cache.hits, (unsigned long long)cache.misses, cache.hitRatio());
+            output += reply;
+        }
+        else if (isBareCommand(line, "PING")) {
+            output += "PONG\n";
+        }
+        else {
+            output += "ERR BAD_REQUEST\n";
+        }
+        ++requestsServed;
+    }
+
+    // Read everything available and answer every complete line.
+    // Returns false if the peer hung up or sent garbage.
+    bool readRequests(int fd, Connection& conn) {
+        if (!readAvailable(fd, conn.input))
+            return false;
+        size_t start = 0;
+        size_t newline;
+        while ((newline = conn.input.find('\n', start)) != string::npos) {
+            conn.input[newline] = '\0';
+            if (newline > start && conn.input[newline - 1] == '\r')
+                conn.input[newline - 1] = '\0';
+            handleRequest(conn.input.c_str() + start, conn);
+            start = newline + 1;
+        }
+        conn.input.erase(0, start);
+        return conn.input.size() <= maxLineLength;
+    }
+
+public:
+    OrderServer(PointOfSaleSystem& pos, const Endpoint& endpoint)
+        : pos(pos), endpoint(endpoint) {
+    }
+
+    ~OrderServer() {
+        for (auto& entry : connections)
+            close(entry.first);
+        if (epollFd >= 0)
+            close(epollFd);
+        if (listenFd >= 0) {
+            close(listenFd);
+            if (endpoint.isUnix)
+                unlink(endpoint.path.c_str());
+        }
+    }
+
+    bool run() {
+        listenFd = listenOnEndpoint(endpoint);
+        if (listenFd < 0) {
+            cout << "Could not listen on endpoint: " << strerror(errno) << "\n";
+            return false;
+        }
+        epollFd = epoll_create1(0);
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = listenFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+
+        signal(SIGINT, requestServerStop);
+        signal(SIGTERM, requestServerStop);
+        cout << "Order server listening. Press Ctrl+C to stop.\n";
+
+        const int maxEvents = 256;
+        epoll_event events[maxEvents];
+        vector<int> pendingReplies;
+        while (!serverStopRequested) {
+            int count = epoll_wait(epollFd, events, maxEvents, 500);
+            if (count < 0) {
+                if (errno == EINTR)
+                    continue;
+                cout << "epoll_wait failed: " << strerror(errno) << "\n";
+                break;
+            }
+            pendingReplies.clear();
+            for (int i = 0; i < count; i++) {
+                int fd = events[i].data.fd;
+                if (fd == listenFd) {
+                    acceptClients();
+                    continue;
+                }
+                auto it = connections.find(fd);
+                if (it == connections.end())
+                    continue;
+                if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                    if (!readRequests(fd, it->second)) {
+                        closeConnection(fd);
+                        continue;
+                    }
+                }
+                pendingReplies.push_back(fd);
+            }
+            // Group commit: one flush for the whole batch, then reply. Sales
+            // the journals could not record are answered with an error.
+            bool recorded = pos.flushChanges();
+            for (int fd : pendingReplies) {
+                auto it = connections.find(fd);
+                if (it == connections.end())
+                    continue;
+                if (!recorded)
+                    retractSales(it->second);
+                it->second.sales.clear();
+                epoll_data_t tag;
+                tag.fd = fd;
+                if (!it->second.output.flush(epollFd, fd, tag))
+                    closeConnection(fd);
+            }
+        }
+        pos.flushChanges();
+        cout << "\nOrder server stopped after " << requestsServed << " requests.\n";
+        return true;
+    }
+};
+
+// --------------------- Load Generator ---------------------
+// Drives an order server over several pipelined connections and reports
+// throughput and latency percentiles. Latency is measured from the moment a
+// request is queued on the client until its reply line arrives. Against a
+// sharded catalog it opens connections to every shard and sends each request
+// straight to the shard that owns the product.
+struct LoadTestResult {
+    long long completed = 0;
+    long long errors = 0;
+    double seconds = 0;
+    double throughput = 0;
+    double p50 = 0;
+    double p99 = 0;
+    double max = 0;
+};
+
+class LoadGenerator {
+private:
+    struct ClientConnection {
+        int fd = -1;
+        int shard = 0;
+        string input;
+        OutputBuffer output;
+        deque<chrono::steady_clock::time_point> inFlight;
+        long long toSend = 0;
+        long long received = 0;
+    };
+
+    vector<Endpoint> endpoints;  // One per shard
+    ShardMap shardMap;
+    int connectionsPerShard;
+    long long totalRequests;
+    int pipelineDepth;
+    int orderPercent;
+    vector<vector<int>> idsByShard;
+    mt19937 rng{ 12345 };
+    vector<double> latenciesMicros;
+    long long errorReplies = 0;
+
+    void queueRequests(ClientConnection& conn) {
+        char request[64];
+        const vector<int>& ids = idsByShard[conn.shard];
+        while ((int)conn.inFlight.size() < pipelineDepth && conn.toSend > 0) {
+            int id = ids[rng() % ids.size()];
+            if ((int)(rng() % 100) < orderPercent)
+                snprintf(request, sizeof(request), "ORDER %d 1\n", id);
+            else
+                snprintf(request, sizeof(request), "LOOKUP %d\n", id);
+            conn.output.data += request;
+            conn.inFlight.push_back(chrono::steady_clock::now());
+            --conn.toSend;
+        }
+    }
+
+    bool receiveReplies(ClientConnection& conn) {
+        if (!readAvailable(conn.fd, conn.input))
+            return false;
+        auto now = chrono::steady_clock::now();
+        size_t start = 0;
+        size_t newline;
+        while ((newline = conn.input.find('\n', start)) != string::npos) {
+            if (conn.inFlight.empty())
+                return false;  // Reply without a request: protocol error
+            if (conn.input.compare(start, 4, "ERR ") == 0)
+                ++errorReplies;
+            latenciesMicros.push_back(
+                chrono::duration<double, micro>(now - conn.inFlight.front()).count());
+            conn.inFlight.pop_front();
+            ++conn.received;
+            start = newline + 1;
+        }
+        conn.input.erase(0, start);
+        return true;
+    }
+
+public:
+    LoadGenerator(const vector<Endpoint>& endpoints, const ShardMap& shardMap,
+        int connectionsPerShard, long long totalRequests, int pipelineDepth,
+        int maxProductId, int orderPercent)
+        : endpoints(endpoints), shardMap(shardMap), connectionsPerShard(connectionsPerShard),
+        totalRequests(totalRequests), pipelineDepth(pipelineDepth), orderPercent(orderPercent),
+        idsByShard(endpoints.size()) {
+        for (int id = 1; id <= maxProductId; id++)
+            idsByShard[shardMap.shardFor(id) % endpoints.size()].push_back(id);
+    }
+
+    bool run(LoadTestResult& result) {
+        // Shards that own no ids in the tested range get no connections
+        vector<int> activeShards;
+        for (size_t shard = 0; shard < endpoints.size(); shard++)
+            if (!idsByShard[shard].empty())
+                activeShards.push_back((int)shard);
+        int connectionCount = (int)activeShards.size() * connectionsPerShard;
+        vector<ClientConnection> clients(connectionCount);
+        int epollFd = epoll_create1(0);
+        for (int i = 0; i < connectionCount; i++) {
+            ClientConnection& conn = clients[i];
+            conn.shard = activeShards[i % activeShards.size()];
+            conn.fd = connectToEndpoint(endpoints[conn.shard]);
+            if (conn.fd < 0) {
+                cout << "Could not connect to server: " << strerror(errno) << "\n";
+                for (auto& c : clients)
+                    if (c.fd >= 0) close(c.fd);
+                close(epollFd);
+                return false;
+            }
+            setNonBlocking(conn.fd);
+            conn.toSend = totalRequests / connectionCount + (i < totalRequests % connectionCount ? 1 : 0);
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.ptr = &conn;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, conn.fd, &ev);
+        }
+        latenciesMicros.clear();
+        latenciesMicros.reserve(totalRequests);
+        errorReplies = 0;
+
+        auto startTime = chrono::steady_clock::now();
+        bool ok = true;
+        for (auto& conn : clients) {
+            epoll_data_t tag;
+            tag.ptr = &conn;
+            queueRequests(conn);
+            ok = ok && conn.output.flush(epollFd, conn.fd, tag);
+        }
+        long long completed = 0;
+        epoll_event events[64];
+        while (ok && completed < totalRequests) {
+            int count = epoll_wait(epollFd, events, 64, 5000);
+            if (count < 0 && errno == EINTR)
+                continue;
+            if (count <= 0) {
+                cout << "Timed out waiting for server replies.\n";
+                ok = false;
+                break;
+            }
+            for (int i = 0; i < count && ok; i++) {
+                ClientConnection& conn = *(ClientConnection*)events[i].data.ptr;
+                if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                    long long before = conn.received;
+                    ok = receiveReplies(conn);
+                    completed += conn.received - before;
+                    queueRequests(conn);
+                }
+                ok = ok && conn.output.flush(epollFd, conn.fd, events[i].data);
+            }
+        }
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        for (auto& conn : clients)
+            close(conn.fd);
+        close(epollFd);
+        if (!ok || latenciesMicros.empty()) {
+            cout << "Load test aborted after " << completed << " replies.\n";
+            return false;
+        }
+
+        sort(latenciesMicros.begin(), latenciesMicros.end());
+        auto percentile = [&](double p) {
+            size_t index = (size_t)(p * (latenciesMicros.size() - 1));
+            return latenciesMicros[index];
+        };
+        result.completed = completed;
+        result.errors = errorReplies;
+        result.seconds = elapsed;
+        result.throughput = completed / elapsed;
+        result.p50 = percentile(0.50);
+        result.p99 = percentile(0.99);
+        result.max = latenciesMicros.back();
+        return true;
+    }
+
+    void printReport(const LoadTestResult& result) const {
+        cout << "\nLoad Test Results\n";
+        cout << "----------------------------------------\n";
+        cout << "Requests:     " << result.completed << " (" << result.errors << " error replies)\n";
+        cout << "Connections:  " << connectionsPerShard * endpoints.size()
+            << " x pipeline depth " << pipelineDepth << "\n";
+        cout << fixed << setprecision(2);
+        cout << "Elapsed:      " << result.seconds << " s\n";
+        cout << "Throughput:   " << result.throughput << " req/s\n";
+        cout << "Latency p50:  " << result.p50 << " us\n";
+        cout << "Latency p99:  " << result.p99 << " us\n";
+        cout << "Latency max:  " << result.max << " us\n";
+    }
+};
+
+// --------------------- Order Log Replay ---------------------
+// Re-send the sales recorded in an order log to a server, keeping their
+// original spacing divided by speed (0 sends them back to back with up to 128
+// in flight). Replies are compared with the recorded totals, so a build that
+// prices differently shows up as mismatches.
+bool runReplayLoad(const Endpoint& endpoint, const string& logPath, double speed) {
+    ifstream file(logPath);
+    if (!file) {
+        cout << "Could not open " << logPath << ".\n";
+        return false;
+    }
+    vector<LoggedOrder> orders;
+    string line;
+    while (getline(file, line)) {
+        LoggedOrder order;
+        if (!line.empty() && parseLoggedOrder(line, order))
+            orders.push_back(order);
+    }
+    file.close();
+    if (orders.empty()) {
+        cout << "No orders to replay in " << logPath << ".\n";
+        return false;
+    }
+    sort(orders.begin(), orders.end(), [](const LoggedOrder& a, const LoggedOrder& b) {
+        return a.sequence < b.sequence;
+    });
+
+    int fd = connectToEndpoint(endpoint);
+    if (fd < 0) {
+        cout << "Could not connect to server: " << strerror(errno) << "\n";
+        return false;
+    }
+    setNonBlocking(fd);
+    int epollFd = epoll_create1(0);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+
+    struct InFlight {
+        chrono::steady_clock::time_point sent;
+        double recordedTotal;
+    };
+    const size_t maxInFlight = 128;
+    deque<InFlight> inFlight;
+    OutputBuffer output;
+    string input;
+    vector<double> latenciesMicros;
+    latenciesMicros.reserve(orders.size());
+    long long errors = 0, mismatches = 0;
+    double maxLagMillis = 0;
+    size_t next = 0;
+    const long long firstMillis = orders.front().timeMillis;
+    auto start = chrono::steady_clock::now();
+    auto dueAt = [&](const LoggedOrder& order) {
+        if (speed <= 0)
+            return start;
+        return start + chrono::duration_cast<chrono::steady_clock::duration>(
+            chrono::duration<double, milli>((order.timeMillis - firstMillis) / speed));
+    };
+
+    bool ok = true;
+    while (ok && (next < orders.size() || !inFlight.empty())) {
+        auto now = chrono::steady_clock::now();
+        char request[64];
+        while (next < orders.size() && dueAt(orders[next]) <= now
+            && (speed > 0 || inFlight.size() < maxInFlight)) {
+            const LoggedOrder& order = orders[next++];
+            snprintf(request, sizeof(request), "ORDER %d %d\n", order.productId, order.quantity);
+            output.data += request;
+            inFlight.push_back({ now, order.totalPrice });
+            maxLagMillis = max(maxLagMillis,
+                chrono::duration<double, milli>(now - dueAt(order)).count());
+        }
+        epoll_data_t tag;
+        tag.fd = fd;
+        ok = output.flush(epollFd, fd, tag);
+
+        int timeoutMillis = 5000;
+        if (next < orders.size() && (speed > 0 || inFlight.size() < maxInFlight)) {
+            auto wait = chrono::duration_cast<chrono::milliseconds>(dueAt(orders[next]) - now).count();
+            timeoutMillis = (int)max<long long>(0, min<long long>(wait, 5000));
+        }
+        epoll_event events[4];
+        int count = epoll_wait(epollFd, events, 4, timeoutMillis);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count == 0 && !inFlight.empty() && timeoutMillis == 5000) {
+            cout << "Timed out waiting for server replies.\n";
+            ok = false;
+        }
+        if (count <= 0 || !ok)
+            continue;
+        if (!readAvailable(fd, input)) {
+            ok = false;
+            break;
+        }
+        now = chrono::steady_clock::now();
+        size_t begin = 0, newline;
+        while ((newline = input.find('\n', begin)) != string::npos) {
+            if (inFlight.empty()) {
+                ok = false;
+                break;
+            }
+            double total;
+            if (input.compare(begin, 3, "OK ") == 0) {
+                string_view text(input.data() + begin + 3, newline - begin - 3);
+                if (!parseField(text, total) || fabs(total - inFlight.front().recordedTotal) > 0.005)
+                    ++mismatches;
+            }
+            else {
+                ++errors;
+            }
+            latenciesMicros.push_back(chrono::duration<double, micro>(now - inFlight.front().sent).count());
+            inFlight.pop_front();
+            begin = newline + 1;
+        }
+        input.erase(0, begin);
+    }
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    close(fd);
+    close(epollFd);
+    if (!ok || latenciesMicros.empty()) {
+        cout << "Replay aborted after " << latenciesMicros.size() << " replies.\n";
+        return false;
+    }
+
+    sort(latenciesMicros.begin(), latenciesMicros.end());
+    auto percentile = [&](double p) {
+        return latenciesMicros[(size_t)(p * (latenciesMicros.size() - 1))];
+    };
+    double recordedSeconds = (orders.back().timeMillis - firstMillis) / 1000.0;
+    cout << "\nOrder Log Replay\n";
+    cout << "----------------------------------------\n";
+    cout << "Orders:          " << latenciesMicros.size() << " (" << errors << " error replies, "
+        << mismatches << " totals differ from the log)\n";
+    cout << fixed << setprecision(2);
+    cout << "Recorded span:   " << recordedSeconds << " s\n";
+    if (speed > 0)
+        cout << "Speed:           " << speed << "x (max send lag " << maxLagMillis << " ms)\n";
+    else
+        cout << "Speed:           as fast as possible\n";
+    cout << "Elapsed:         " << elapsed << " s\n";
+    cout << "Throughput:      " << latenciesMicros.size() / elapsed << " orders/s\n";
+    cout << "Latency p50:     " << percentile(0.50) << " us\n";
+    cout << "Latency p99:     " << percentile(0.99) << " us\n";
+    cout << "Latency max:     " << latenciesMicros.back() << " us\n";
+    return true;
+}
+
+// --------------------- Sharded Catalog ---------------------
+// Split products.csv into one file per shard according to map. Sales in
+// orderlog.csv newer than the snapshot are applied first, every shard file
+// starts at the resulting sequence, and old shard order logs are removed so
+// a restarted worker cannot replay them onto the new split.
+bool splitCatalogIntoShards(const string& productFile, const ShardMap& map) {
+    ifstream file(productFile);
+    if (!file) {
+        cout << "Could not open " << productFile << ".\n";
+        return false;
+    }
+    vector<Product> products;
+    unsigned long long sequence = 0;
+    bool hasSequence = false;
+    string line;
+    Product product;
+    while (getline(file, line)) {
+        if (line.empty()) continue;
+        if (line.compare(0, 10, "#sequence,") == 0) {
+            hasSequence = from_chars(line.data() + 10, line.data() + line.size(), sequence).ec == errc();
+            continue;
+        }
+        if (!parseProductCSV(line, product)) {
+            cout << "Skipping malformed record: " << line << "\n";
+            continue;
+        }
+        products.push_back(product);
+    }
+    file.close();
+
+    unordered_map<int, long long> unitsSold;
+    unsigned long long lastSequence = sequence;
+    ifstream log("orderlog.csv");
+    LoggedOrder order;
+    while (getline(log, line)) {
+        if (!parseLoggedOrder(line, order))
+            continue;
+        lastSequence = max(lastSequence, order.sequence);
+        if (hasSequence && order.sequence > sequence)
+            unitsSold[order.productId] += order.quantity;
+    }
+    vector<string> shardRows(map.shardCount(), "#sequence," + to_string(lastSequence) + "\n");
+    for (auto& split : products) {
+        auto sold = unitsSold.find(split.id);
+        if (sold != unitsSold.end())
+            split.quantity -= (int)sold->second;
+        appendProductCSV<CsvStyle::Exact>(shardRows[map.shardFor(split.id)], split);
+    }
+    for (int shard = 0; shard < map.shardCount(); shard++) {
+        if (!writeFileAtomically("products" + ShardMap::fileSuffix(shard) + ".csv", shardRows[shard]))
+            return false;
+        remove(("orderlog" + ShardMap::fileSuffix(shard) + ".csv").c_str());
+    }
+    return map.save("shards.csv");
+}
+
+// Fork one order server per shard; each works on its own files.
+// Quiet workers send their console output to /dev/null.
+vector<pid_t> startShardWorkers(const ShardMap& map, bool quiet) {
+    vector<pid_t> workers;
+    cout.flush();  // Otherwise buffered output is printed again by every child
+    for (int shard = 0; shard < map.shardCount(); shard++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            if (quiet) {
+                int devNull = open("/dev/null", O_WRONLY);
+                dup2(devNull, STDOUT_FILENO);
+                close(devNull);
+            }
+            Endpoint endpoint;
+            parseEndpoint(ShardMap::endpointFor(shard), endpoint);
+            int status;
+            {
+                PointOfSaleSystem system(ShardMap::fileSuffix(shard));
+                system.numberHolds(shard + 1, map.shardCount());
+                OrderServer server(system, endpoint);
+                status = server.run() ? 0 : 1;
+            }
+            cout.flush();
+            _exit(status);
+        }
+        if (pid > 0)
+            workers.push_back(pid);
+    }
+    // Wait until every worker accepts connections
+    for (int shard = 0; shard < map.shardCount(); shard++) {
+        Endpoint endpoint;
+        parseEndpoint(ShardMap::endpointFor(shard), endpoint);
+        for (int attempt = 0; attempt < 100; attempt++) {
+            int fd = connectToEndpoint(endpoint);
+            if (fd >= 0) {
+                close(fd);
+                break;
+            }
+            this_thread::sleep_for(chrono::milliseconds(50));
+        }
+    }
+    return workers;
+}
+
+void stopShardWorkers(const vector<pid_t>& workers) {
+    for (pid_t pid : workers)
+        kill(pid, SIGTERM);
+    for (pid_t pid : workers)
+        waitpid(pid, nullptr, 0);
+}
+
+// Front end for a sharded catalog. Speaks the order server protocol, sends
+// ORDER, LOOKUP, QUOTE, HOLD and AVAIL to the shard owning the product,
+// CONFIRM and RELEASE to the shard that numbered the hold, and fans VALUE
+// and STATS out to every shard, adding up the answers. Each client's replies are released in
+// request order even though shards answer independently.
+class ShardRouter {
+private:
+    struct PendingReply {
+        string text;
+        int waitingFor = 0;  // Shard replies still missing
+        string passThrough;  // Single-shard reply, or the first error of a fan-out
+        double value = 0;
+        long long units = 0;
+        long long products = 0;
+        unsigned long long hits = 0;
+        unsigned long long misses = 0;
+    };
+
+    struct Client {
+        string input;
+        OutputBuffer output;
+        deque<shared_ptr<PendingReply>> replies;  // In request order
+    };
+
+    struct Shard {
+        int fd = -1;
+        string input;
+        OutputBuffer output;
+        deque<shared_ptr<PendingReply>> awaiting;  // Shards reply in order too
+    };
+
+    static const size_t maxLineLength = 4096;
+
+    ShardMap map;
+    Endpoint endpoint;
+    int listenFd = -1;
+    int epollFd = -1;
+    vector<Shard> shards;
+    unordered_map<int, Client> clients;
+    vector<int> dirtyClients;
+    vector<bool> dirtyShards;
+
+    // Epoll tags: shard sockets are stored as -(index + 1), clients as their fd
+    static epoll_data_t clientTag(int fd) {
+        epoll_data_t tag;
+        tag.u64 = 0;
+        tag.fd = fd;
+        return tag;
+    }
+
+    static epoll_data_t shardTag(int index) {
+        epoll_data_t tag;
+        tag.u64 = 0;
+        tag.fd = -(index + 1);
+        return tag;
+    }
+
+    void forward(int shard, const char* line, const shared_ptr<PendingReply>& reply) {
+        shards[shard].output.data += line;
+        shards[shard].output.data += '\n';
+        shards[shard].awaiting.push_back(reply);
+        dirtyShards[shard] = true;
+    }
+
+    void handleRequest(int fd, Client& client, const char* line) {
+        auto reply = make_shared<PendingReply>();
+        client.replies.push_back(reply);
+        dirtyClients.push_back(fd);
+        long id;
+        const char* p = line;
+        if (strncmp(line, "ORDER ", 6) == 0 || strncmp(line, "LOOKUP ", 7) == 0
+            || strncmp(line, "QUOTE ", 6) == 0 || strncmp(line, "HOLD ", 5) == 0
+            || strncmp(line, "AVAIL ", 6) == 0) {
+            p = strchr(line, ' ');
+            if (!parseIntToken(p, id)) {
+                reply->text = "ERR BAD_REQUEST\n";
+                return;
+            }
+            reply->waitingFor = 1;
+            forward(map.shardFor((int)id), line, reply);
+        }
+        else if (strncmp(line, "CONFIRM ", 8) == 0 || strncmp(line, "RELEASE ", 8) == 0) {
+            p += 8;
+            if (!parseIntToken(p, id, 1, numeric_limits<long>::max())) {
+                reply->text = "ERR BAD_REQUEST\n";
+                return;
+            }
+            reply->waitingFor = 1;  // Worker i numbers its holds i + 1, i + 1 + shards, ...
+            forward((int)((id - 1) % map.shardCount()), line, reply);
+        }
+        else if (isBareCommand(line, "VALUE") || isBareCommand(line, "STATS")) {
+            reply->waitingFor = (int)shards.size();
+            for (size_t shard = 0; shard < shards.size(); shard++)
+                forward((int)shard, line, reply);
+        }
+        else if (isBareCommand(line, "PING")) {
+            reply->text = "PONG\n";
+        }
+        else {
+            reply->text = "ERR BAD_REQUEST\n";
+        }
+    }
+
+    bool readClient(int fd, Client& client) {
+        if (!readAvailable(fd, client.input))
+            return false;
+        size_t start = 0;
+        size_t newline;
+        while ((newline = client.input.find('\n', start)) != string::npos) {
+            client.input[newline] = '\0';
+            if (newline > start && client.input[newline - 1] == '\r')
+                client.input[newline - 1] = '\0';
+            handleRequest(fd, client, client.input.c_str() + start);
+            start = newline + 1;
+        }
+        client.input.erase(0, start);
+        return client.input.size() <= maxLineLength;
+    }
+
+    // Match shard replies to waiting requests; false if the shard went away
+    bool readShard(Shard& shard) {
+        if (!readAvailable(shard.fd, shard.input))
+            return false;
+        size_t start = 0;
+        size_t newline;
+        while ((newline = shard.input.find('\n', start)) != string::npos) {
+            if (shard.awaiting.empty())
+                return false;
+            shared_ptr<PendingReply> reply = shard.awaiting.front();
+            shard.awaiting.pop_front();
+            bool value = shard.input.compare(start, 6, "VALUE ") == 0;
+            bool stats = shard.input.compare(start, 6, "STATS ") == 0;
+            if (value) {
+                double shardValue = 0;
+                long long units = 0, products = 0;
+                sscanf(shard.input.c_str() + start + 6, "%lf %lld %lld", &shardValue, &units, &products);
+                reply->value += shardValue;
+                reply->units += units;
+                reply->products += products;
+            }
+            else if (stats) {
+                unsigned long long hits = 0, misses = 0;
+                sscanf(shard.input.c_str() + start + 6, "%llu %llu", &hits, &misses);
+                reply->hits += hits;
+                reply->misses += misses;
+            }
+            else if (reply->passThrough.empty()) {
+                reply->passThrough.assign(shard.input, start, newline - start + 1);
+            }
+            // A fanned-out request is answered once every shard has replied,
+            // with the first error if any shard refused it
+            if (--reply->waitingFor == 0) {
+                char text[128];
+                if (!reply->passThrough.empty()) {
+                    reply->text = reply->passThrough;
+                }
+                else if (value) {
+                    snprintf(text, sizeof(text), "VALUE %.2f %lld %lld\n",
+                        reply->value, reply->units, reply->products);
+                    reply->text = text;
+                }
+                else {
+                    unsigned long long lookups = reply->hits + reply->misses;
+                    snprintf(text, sizeof(text), "STATS %llu %llu %.4f\n", reply->hits, reply->misses,
+                        lookups ? (double)reply->hits / lookups : 0.0);
+                    reply->text = text;
+                }
+            }
+            start = newline + 1;
+        }
+        shard.input.erase(0, start);
+        return true;
+    }
 
-            while (true) {
-                cout << "Enter your choice: ";
-                if (getValidatedInteger(choice)) {
-                    break;
+    // Move every finished reply at the head of the client's queue to its output
+    void releaseReplies(int fd) {
+        auto it = clients.find(fd);
+        if (it == clients.end())
+            return;
+        Client& client = it->second;
+        while (!client.replies.empty() && client.replies.front()->waitingFor == 0) {
+            client.output.data += client.replies.front()->text;
+            client.replies.pop_front();
+        }
+        if (!client.output.flush(epollFd, fd, clientTag(fd))) {
+            epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+            close(fd);
+            clients.erase(it);
+        }
+    }
+
+    void closeClient(int fd) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        close(fd);
+        clients.erase(fd);
+    }
+
+public:
+    ShardRouter(const ShardMap& map, const Endpoint& endpoint)
+        : map(map), endpoint(endpoint), shards(map.shardCount()), dirtyShards(map.shardCount()) {
+    }
+
+    ~ShardRouter() {
+        for (auto& entry : clients)
+            close(entry.first);
+        for (auto& shard : shards)
+            if (shard.fd >= 0) close(shard.fd);
+        if (epollFd >= 0)
+            close(epollFd);
+        if (listenFd >= 0) {
+            close(listenFd);
+            if (endpoint.isUnix)
+                unlink(endpoint.path.c_str());
+        }
+    }
+
+    bool run() {
+        epollFd = epoll_create1(0);
+        for (int index = 0; index < map.shardCount(); index++) {
+            Endpoint shardEndpoint;
+            parseEndpoint(ShardMap::endpointFor(index), shardEndpoint);
+            shards[index].fd = connectToEndpoint(shardEndpoint);
+            if (shards[index].fd < 0) {
+                cout << "Could not connect to shard " << index << ".\n";
+                return false;
+            }
+            setNonBlocking(shards[index].fd);
+            epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data = shardTag(index);
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, shards[index].fd, &ev);
+        }
+        listenFd = listenOnEndpoint(endpoint);
+        if (listenFd < 0) {
+            cout << "Could not listen on endpoint: " << strerror(errno) << "\n";
+            return false;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data = clientTag(listenFd);
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+
+        signal(SIGINT, requestServerStop);
+        signal(SIGTERM, requestServerStop);
+        cout << "Shard router listening in front of " << map.shardCount()
+            << " shards. Press Ctrl+C to stop.\n";
+
+        const int maxEvents = 256;
+        epoll_event events[maxEvents];
+        while (!serverStopRequested) {
+            int count = epoll_wait(epollFd, events, maxEvents, 500);
+            if (count < 0) {
+                if (errno == EINTR)
+                    continue;
+                cout << "epoll_wait failed: " << strerror(errno) << "\n";
+                break;
+            }
+            dirtyClients.clear();
+            for (int i = 0; i < count; i++) {
+                int fd = events[i].data.fd;
+                if (fd < 0) {
+                    Shard& shard = shards[-fd - 1];
+                    if ((events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) && !readShard(shard)) {
+                        cout << "Lost connection to shard " << (-fd - 1) << ".\n";
+                        return false;
+                    }
+                    dirtyShards[-fd - 1] = true;
+                    for (auto& entry : clients)
+                        dirtyClients.push_back(entry.first);
+                    continue;
                 }
-                cout << "Invalid input. Please enter a valid number.\n";
+                if (fd == listenFd) {
+                    int clientFd;
+                    while ((clientFd = accept(listenFd, nullptr, nullptr)) >= 0) {
+                        setNonBlocking(clientFd);
+                        epoll_event clientEvent{};
+                        clientEvent.events = EPOLLIN;
+                        clientEvent.data = clientTag(clientFd);
+                        epoll_ctl(epollFd, EPOLL_CTL_ADD, clientFd, &clientEvent);
+                        clients[clientFd];
+                    }
+                    continue;
+                }
+                auto it = clients.find(fd);
+                if (it == clients.end())
+                    continue;
+                if ((events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) && !readClient(fd, it->second)) {
+                    closeClient(fd);
+                    continue;
+                }
+                dirtyClients.push_back(fd);
             }
+            for (size_t index = 0; index < shards.size(); index++) {
+                if (!dirtyShards[index])
+                    continue;
+                dirtyShards[index] = false;
+                if (!shards[index].output.flush(epollFd, shards[index].fd, shardTag((int)index))) {
+                    cout << "Lost connection to shard " << index << ".\n";
+                    return false;
+                }
+            }
+            sort(dirtyClients.begin(), dirtyClients.end());
+            dirtyClients.erase(unique(dirtyClients.begin(), dirtyClients.end()), dirtyClients.end());
+            for (int fd : dirtyClients)
+                releaseReplies(fd);
+        }
+        cout << "\nShard router stopped.\n";
+        return true;
+    }
+};
 
-            switch (choice) {
-            case 1: addProduct(); break;
-            case 2: showAvailableProducts(); break;
-            case 3: modifyProduct(); break;
-            case 4: deleteProduct(); break;
-            case 5: addAdmin(); break;
-            case 6: searchProduct(); break;
-            case 7: sortProductsById(); break;
-            case 8: viewTotalInventoryValue(); break;
-            case 9: generateReport(); break;
-            case 10: checkLowStockLevels(); break;
-            case 11: cout << "\nExiting Admin Menu...\n"; break;
-            default: cout << "\nInvalid choice. Please try again.\n";
+// Benchmark order throughput against 1, 2, 4 ... maxShards worker processes.
+// Each round runs in a scratch directory with a generated catalog split by
+// hash, and the load generator routes every request straight to its shard.
+bool runShardBenchmark(int maxShards, long long requests, int productCount) {
+    char scratch[] = "/tmp/pos-shard-bench-XXXXXX";
+    if (!mkdtemp(scratch)) {
+        cout << "Could not create a scratch directory.\n";
+        return false;
+    }
+    char original[4096];
+    if (!getcwd(original, sizeof(original)) || chdir(scratch) != 0)
+        return false;
+
+    string catalog;
+    for (int id = 1; id <= productCount; id++) {
+        appendProductCSV<CsvStyle::Exact>(catalog, Product(id, "Item " + to_string(id),
+            "Category " + to_string(id % 20), 100 + id % 900, 1000000, "2030-01-01", 5, 2));
+    }
+    writeFileAtomically("products.csv", catalog);
+
+    cout << "\nShard Scaling Benchmark (" << productCount << " products, "
+        << requests << " requests per round, 50% orders)\n";
+    cout << left << setw(10) << "Shards" << setw(18) << "Throughput/s"
+        << setw(14) << "p50 (us)" << setw(14) << "p99 (us)" << "Speedup\n";
+    cout << string(66, '-') << "\n";
+    double baseline = 0;
+    bool ok = true;
+    for (int count = 1; count <= maxShards && ok; count *= 2) {
+        ShardMap map = ShardMap::hashed(count);
+        ok = splitCatalogIntoShards("products.csv", map);
+        if (!ok)
+            break;
+        vector<pid_t> workers = startShardWorkers(map, true);
+        vector<Endpoint> endpoints(count);
+        for (int shard = 0; shard < count; shard++)
+            parseEndpoint(ShardMap::endpointFor(shard), endpoints[shard]);
+        LoadGenerator generator(endpoints, map, 2, requests, 32, productCount, 50);
+        LoadTestResult result;
+        ok = generator.run(result);
+        stopShardWorkers(workers);
+        if (!ok)
+            break;
+        if (count == 1)
+            baseline = result.throughput;
+        cout << left << setw(10) << count << fixed << setprecision(0)
+            << setw(18) << result.throughput << setprecision(1)
+            << setw(14) << result.p50 << setw(14) << result.p99
+            << setprecision(2) << result.throughput / baseline << "x\n";
+    }
+    cout << "Hardware threads available: " << thread::hardware_concurrency() << "\n";
+
+    if (chdir(original) != 0)
+        return false;
+    string cleanup = string("rm -rf ") + scratch;
+    if (system(cleanup.c_str()) != 0)
+        cout << "Could not remove " << scratch << ".\n";
+    return ok;
+}
+
+// --------------------- Order Latency Benchmark ---------------------
+// Time processOrder + flushChanges (the path a register waits on) with the
+// journal written inline, as before, and through the I/O thread at each
+// durability level. Runs in a scratch directory on a generated catalog.
+bool runOrderLatencyBenchmark(long long orders, int threads) {
+    char scratch[] = "/tmp/pos-order-bench-XXXXXX";
+    char original[4096];
+    if (!mkdtemp(scratch) || !getcwd(original, sizeof(original)) || chdir(scratch) != 0) {
+        cout << "Could not create a scratch directory.\n";
+        return false;
+    }
+    const int productCount = 2000;
+    string catalog;
+    for (int id = 1; id <= productCount; id++) {
+        appendProductCSV<CsvStyle::Exact>(catalog, Product(id, "Item " + to_string(id),
+            "General", 100 + id % 900, 1000000, "2030-01-01", 5, 2));
+    }
+
+    struct Config {
+        const char* name;
+        Durability durability;
+        bool ioThread;
+    };
+    const Config configs[] = {
+        { "inline, written (old)", Durability::Written, false },
+        { "inline, fsync", Durability::Synced, false },
+        { "I/O thread, async", Durability::Async, true },
+        { "I/O thread, written", Durability::Written, true },
+        { "I/O thread, fsync", Durability::Synced, true },
+    };
+    cout << "\nOrder Latency Benchmark (" << orders << " orders, " << threads
+        << " register threads, journal backend: "
+        << (IoRing().available() ? "io_uring" : "blocking writes") << ")\n";
+    cout << left << setw(24) << "Journal" << setw(12) << "Mean (us)" << setw(12) << "p50 (us)"
+        << setw(12) << "p99 (us)" << setw(14) << "Orders/s" << "Records/write\n";
+    cout << string(86, '-') << "\n";
+    for (const Config& config : configs) {
+        remove("orders.csv");
+        remove("orderlog.csv");
+        writeFileAtomically("products.csv", catalog);
+        vector<vector<double>> latencies(threads);
+        double elapsed;
+        double recordsPerWrite;
+        {
+            PointOfSaleSystem system("", config.durability, config.ioThread);
+            auto start = chrono::steady_clock::now();
+            vector<thread> registers;
+            for (int t = 0; t < threads; t++) {
+                registers.emplace_back([&, t] {
+                    mt19937 rng(t + 1);
+                    long long share = orders / threads + (t < orders % threads ? 1 : 0);
+                    latencies[t].reserve(share);
+                    for (long long i = 0; i < share; i++) {
+                        double total;
+                        auto before = chrono::steady_clock::now();
+                        system.processOrder(1 + (int)(rng() % productCount), 1, total);
+                        system.flushChanges();
+                        latencies[t].push_back(chrono::duration<double, micro>(
+                            chrono::steady_clock::now() - before).count());
+                    }
+                });
             }
-        } while (choice != 11);
+            for (auto& worker : registers)
+                worker.join();
+            elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            recordsPerWrite = system.journalRecordsPerWrite();
+        }
+        vector<double> all;
+        for (auto& perThread : latencies)
+            all.insert(all.end(), perThread.begin(), perThread.end());
+        sort(all.begin(), all.end());
+        double mean = 0;
+        for (double latency : all)
+            mean += latency;
+        mean /= all.size();
+        cout << left << setw(24) << config.name << fixed << setprecision(1)
+            << setw(12) << mean << setw(12) << all[all.size() / 2]
+            << setw(12) << all[(size_t)(0.99 * (all.size() - 1))]
+            << setprecision(0) << setw(14) << all.size() / elapsed
+            << setprecision(2) << recordsPerWrite << "\n";
     }
 
-    void customerMenu() {
-        int choice;
-        do {
-            cout << "\nCustomer Menu\n";
-            cout << "1. Place Order\n";
-            cout << "2. Show Available Products\n";
-            cout << "3. Add to Wishlist\n";
-            cout << "4. View Wishlist\n";
-            cout << "5. Exit\n";
+    if (chdir(original) != 0)
+        return false;
+    string cleanup = string("rm -rf ") + scratch;
+    if (system(cleanup.c_str()) != 0)
+        cout << "Could not remove " << scratch << ".\n";
+    return true;
+}
 
-            while (true) {
-                cout << "Enter your choice: ";
-                if (getValidatedInteger(choice)) {
-                    break;
-                }
-                cout << "Invalid input. Please enter a valid number.\n";
+// --------------------- Reservation Benchmark ---------------------
+// Place many short holds on a scratch catalog, confirm a third, release a
+// third and let the rest expire, timing each step and checking that stock
+// and held units add up afterwards. Also checks that an order cannot take
+// units someone else holds and that hour-long holds stay in place.
+bool runReservationBenchmark(int holdCount) {
+    char scratch[] = "/tmp/pos-hold-bench-XXXXXX";
+    char original[4096];
+    if (!mkdtemp(scratch) || !getcwd(original, sizeof(original)) || chdir(scratch) != 0) {
+        cout << "Could not create a scratch directory.\n";
+        return false;
+    }
+    const int productCount = 1000;
+    const int initialStock = 1000000;
+    string catalog;
+    for (int id = 1; id <= productCount; id++) {
+        appendProductCSV<CsvStyle::Exact>(catalog, Product(id, "Item " + to_string(id),
+            "General", 100, initialStock, "2030-01-01", 0, 0));
+    }
+    writeFileAtomically("products.csv", catalog);
+
+    bool ok = true;
+    auto check = [&](bool condition, const char* what) {
+        if (!condition) {
+            cout << "FAILED: " << what << "\n";
+            ok = false;
+        }
+    };
+    auto timeMs = [](auto work) {
+        auto start = chrono::steady_clock::now();
+        work();
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    };
+    {
+        PointOfSaleSystem system;
+        mt19937 rng(3);
+        struct Placed {
+            unsigned long long holdId;
+            int productId;
+            int quantity;
+        };
+        vector<Placed> placed;
+        placed.reserve(holdCount);
+        double placeMs = timeMs([&] {
+            for (int i = 0; i < holdCount; i++) {
+                Placed hold{ 0, 1 + (int)(rng() % productCount), 1 + (int)(rng() % 3) };
+                if (system.holdStock(hold.productId, hold.quantity, chrono::seconds(1), hold.holdId)
+                    == PointOfSaleSystem::OrderStatus::Placed)
+                    placed.push_back(hold);
             }
+        });
+        check((int)placed.size() == holdCount, "every hold placed");
 
-            switch (choice) {
-            case 1: placeOrder(); break;
-            case 2: showAvailableProducts(); break;
-            case 3: addToWishlist(); break;
-            case 4: viewWishlist(); break;
-            case 5: cout << "\nExiting Customer Menu...\n"; break;
-            default: cout << "\nInvalid choice. Please try again.\n";
+        vector<long long> expectedHeld(productCount + 1, 0);
+        for (const auto& hold : placed)
+            expectedHeld[hold.productId] += hold.quantity;
+        for (int id = 1; id <= productCount && ok; id++) {
+            int available = 0;
+            long long held = 0;
+            system.availability(id, available, held);
+            check(held == expectedHeld[id] && available == initialStock - held, "held units add up");
+        }
+
+        // Hold all that is left of product 1: an order must now be refused
+        int available = 0;
+        long long held = 0;
+        double total;
+        unsigned long long blocker;
+        system.availability(1, available, held);
+        check(system.holdStock(1, available, chrono::seconds(60), blocker)
+            == PointOfSaleSystem::OrderStatus::Placed, "hold the remaining stock");
+        check(system.processOrder(1, 1, total) == PointOfSaleSystem::OrderStatus::InsufficientStock,
+            "order refused while stock is held");
+        check(system.releaseHold(blocker), "release the blocking hold");
+
+        vector<long long> sold(productCount + 1, 0);
+        size_t third = placed.size() / 3;
+        double confirmMs = timeMs([&] {
+            for (size_t i = 0; i < third; i++) {
+                if (system.confirmHold(placed[i].holdId, total) == PointOfSaleSystem::OrderStatus::Placed)
+                    sold[placed[i].productId] += placed[i].quantity;
             }
-        } while (choice != 5);
+        });
+        double releaseMs = timeMs([&] {
+            for (size_t i = third; i < 2 * third; i++)
+                check(system.releaseHold(placed[i].holdId), "release");
+        });
+        check(system.confirmHold(placed[third].holdId, total) == PointOfSaleSystem::OrderStatus::NoHold,
+            "released hold cannot be confirmed");
+
+        this_thread::sleep_for(chrono::milliseconds(1300));
+        ReservationBook::Stats stats;
+        double expireMs = timeMs([&] { stats = system.reservationStats(); });
+        check(stats.active == 0, "every remaining hold expired");
+        check(stats.expired == placed.size() - 2 * third, "expired count");
+        for (int id = 1; id <= productCount && ok; id++) {
+            system.availability(id, available, held);
+            check(held == 0 && available == initialStock - sold[id], "stock after confirm/release/expiry");
+        }
+
+        // Holds longer than a turn of the wheel wait in its overflow list
+        vector<unsigned long long> longHolds;
+        for (int i = 0; i < 1000; i++) {
+            unsigned long long holdId;
+            if (system.holdStock(1 + i % productCount, 1, chrono::hours(1), holdId)
+                == PointOfSaleSystem::OrderStatus::Placed)
+                longHolds.push_back(holdId);
+        }
+        check(system.reservationStats().active == longHolds.size(), "long holds stay active");
+        system.availability(1, available, held);
+        check(held == 1 && available == initialStock - sold[1] - 1, "long hold counted");
+        for (unsigned long long holdId : longHolds)
+            check(system.releaseHold(holdId), "release a long hold");
+        system.flushChanges();
+
+        auto perHold = [&](double ms, size_t count) { return count ? ms * 1e6 / count : 0.0; };
+        cout << "\nReservation Benchmark (" << holdCount << " holds over " << productCount << " products)\n";
+        cout << left << setw(12) << "Step" << setw(12) << "Holds" << setw(14) << "Total (ms)" << "ns/hold\n";
+        cout << string(50, '-') << "\n" << fixed;
+        auto row = [&](const char* step, size_t count, double ms) {
+            cout << left << setw(12) << step << setw(12) << count << setprecision(2) << setw(14) << ms
+                << setprecision(0) << perHold(ms, count) << "\n";
+        };
+        row("place", placed.size(), placeMs);
+        row("confirm", third, confirmMs);
+        row("release", third, releaseMs);
+        row("expire", (size_t)stats.expired, expireMs);
+        cout << (ok ? "Stock and held units add up.\n" : "FAILED\n");
     }
 
-    void startProgram() {
-        int choice;
-        do {
-            showHeader();
+    if (chdir(original) != 0)
+        return false;
+    string cleanup = string("rm -rf ") + scratch;
+    if (system(cleanup.c_str()) != 0)
+        cout << "Could not remove " << scratch << ".\n";
+    return ok;
+}
 
-            while (true) {
-                cout << "Enter your choice: ";
-                if (getValidatedInteger(choice)) {
-                    break;
-                }
-                cout << "Invalid choice input. Please enter a valid number.\n";
+// --------------------- Import Self-Test ---------------------
+// Imports a supplier file of bad rows into a scratch catalog that has
+// units on hold, and checks every bad row is refused and counted while
+// the good rows still go in.
+bool runImportSelfTest() {
+    char scratch[] = "/tmp/pos-import-test-XXXXXX";
+    char original[4096];
+    if (!mkdtemp(scratch) || !getcwd(original, sizeof(original)) || chdir(scratch) != 0) {
+        cout << "Could not create a scratch directory.\n";
+        return false;
+    }
+    string catalog;
+    appendProductCSV<CsvStyle::Exact>(catalog, Product(1, "Fan", "Electric", 100, 10, "2030-01-01", 0, 0));
+    appendProductCSV<CsvStyle::Exact>(catalog, Product(2, "Lamp", "Electric", 50, 20, "2030-01-01", 0, 0));
+    appendProductCSV<CsvStyle::Exact>(catalog, Product(3, "Bulb", "Lighting", 10, 30, "2030-01-01", 0, 0));
+    writeFileAtomically("products.csv", catalog);
+    writeFileAtomically("supplier.csv", productCSVHeader() + "\n"
+        "101,Neg,Lighting,10,-50,0,0,notadate\n"    // Negative stock and a bad date
+        "102,Neg,Lighting,10,-50,0,0,2030-01-01\n"  // Negative stock
+        "103,Late,Lighting,10,5,0,0,2030-13-45\n"   // Bad date
+        "104,Cheap,Lighting,-1,5,0,0,2030-01-01\n"  // Negative price
+        "105,Deal,Lighting,10,5,150,0,2030-01-01\n" // Discount over 100
+        "106,Taxed,Lighting,10,5,0,-1,2030-01-01\n" // Negative tax
+        "1,Fan,Electric,100,-5,0,0,2030-01-01\n"    // Leaves 5 with 8 held
+        "2,Lamp,Electric,50,-30,0,0,2030-01-01\n"   // Leaves -10
+        "107,Broken,Lighting\n"                      // Malformed
+        "3,Bulb,Lighting,12,-5,0,0,2030-01-01\n"    // Good merge
+        "108,Spot,Lighting,25,4,0,0,2030-01-01\n"   // Good new row
+        "108,Spot,Lighting,25,9,0,0,2030-01-01\n"); // Duplicate id
+
+    bool ok = true;
+    auto check = [&](bool condition, const char* what) {
+        if (!condition) {
+            cout << "FAILED: " << what << "\n";
+            ok = false;
+        }
+    };
+    {
+        PointOfSaleSystem system;
+        unsigned long long holdId;
+        check(system.holdStock(1, 8, chrono::seconds(60), holdId) == PointOfSaleSystem::OrderStatus::Placed,
+            "hold units of product 1");
+        PointOfSaleSystem::ImportSummary summary;
+        check(system.importProducts("supplier.csv", summary), "open the supplier file");
+        check(summary.added == 1 && summary.merged == 1, "only the good rows go in");
+        check(summary.invalid == 6 && summary.stockShort == 2 && summary.malformed == 1
+            && summary.duplicates == 1 && summary.rejected() == 10, "rejected rows counted");
+
+        int available = 0;
+        long long held = 0;
+        for (int id = 101; id <= 106; id++)
+            check(!system.availability(id, available, held), "bad new row refused");
+        check(system.availability(1, available, held) && available == 2 && held == 8, "held stock untouched");
+        check(system.availability(2, available, held) && available == 20, "stock kept above zero");
+        check(system.availability(3, available, held) && available == 25, "good merge applied");
+        check(system.availability(108, available, held) && available == 4, "good row added");
+        system.flushChanges();
+        ifstream saved("products.csv");
+        stringstream contents;
+        contents << saved.rdbuf();
+        check(contents.str().find("notadate") == string::npos, "bad row not saved");
+
+        cout << "\nImport Self-Test\n";
+        cout << "Rows added: " << summary.added << ", merged: " << summary.merged
+            << ", rejected: " << summary.rejected() << "\n";
+        cout << (ok ? "Bad rows refused.\n" : "FAILED\n");
+    }
+
+    if (chdir(original) != 0)
+        return false;
+    string cleanup = string("rm -rf ") + scratch;
+    if (system(cleanup.c_str()) != 0)
+        cout << "Could not remove " << scratch << ".\n";
+    return ok;
+}
+#endif
+
+// --------------------- Price Cache Benchmark ---------------------
+// Price quotes against a large catalog: search the tree and price every
+// time, against the same quotes through HotPriceCache (tree + store on a
+// miss), for Zipf-skewed traffic and for uniform traffic. Every cached price
+// is checked against the uncached one.
+bool runPriceCacheBenchmark(int productCount, int quoteCount) {
+    vector<Product> products;
+    products.reserve(productCount);
+    mt19937 rng(23);
+    for (int id = 1; id <= productCount; id++) {
+        products.emplace_back(id, "Item " + to_string(id), "Category " + to_string(id % 50),
+            (double)(rng() % 1000000) / 100, 100, "2030-01-01", (double)(rng() % 50), (double)(rng() % 18));
+    }
+    ProductTree tree;
+    tree.bulkMerge(products, [](Product&, const Product&) {});
+    CatalogSnapshot catalog = tree.snapshot();
+
+    // Zipf(1) over the catalog: item k is asked for in proportion to 1 / k.
+    // Popular ranks are scattered over the id range.
+    vector<double> cumulative(productCount);
+    double sum = 0;
+    for (int k = 0; k < productCount; k++)
+        cumulative[k] = sum += 1.0 / (k + 1);
+    vector<int> rankToId(productCount);
+    for (int k = 0; k < productCount; k++)
+        rankToId[k] = k + 1;
+    shuffle(rankToId.begin(), rankToId.end(), rng);
+    uniform_real_distribution<double> pick(0, sum);
+    vector<int> skewed(quoteCount), uniform(quoteCount);
+    for (int i = 0; i < quoteCount; i++) {
+        size_t rank = lower_bound(cumulative.begin(), cumulative.end(), pick(rng)) - cumulative.begin();
+        skewed[i] = rankToId[min<size_t>(rank, productCount - 1)];
+        uniform[i] = 1 + (int)(rng() % productCount);
+    }
+
+    auto timeNs = [&](const vector<int>& ids, auto quote) {
+        auto start = chrono::steady_clock::now();
+        double checksum = 0;
+        for (int id : ids)
+            checksum += quote(id);
+        double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / ids.size();
+        return make_pair(ns, checksum);
+    };
+    auto uncached = [&](int id) {
+        const Product* product = catalog.search(id);
+        return product ? finalUnitPrice(*product) : 0.0;
+    };
+    bool same = true;
+    cout << "\nPrice Cache Benchmark (" << productCount << " products, " << quoteCount << " quotes)\n";
+    cout << left << setw(12) << "Traffic" << setw(16) << "Tree (ns)" << setw(16) << "Cached (ns)"
+        << setw(12) << "Hit ratio" << "Speedup\n";
+    cout << string(66, '-') << "\n";
+    for (int round = 0; round < 2; round++) {
+        const vector<int>& ids = round == 0 ? skewed : uniform;
+        HotPriceCache cache;
+        auto viaCache = [&](int id) {
+            double unitPrice;
+            if (cache.lookup(id, unitPrice))
+                return unitPrice;
+            uint64_t generation = cache.generation();
+            unitPrice = uncached(id);
+            cache.store(id, unitPrice, generation);
+            return unitPrice;
+        };
+        auto tree = timeNs(ids, uncached);
+        auto cached = timeNs(ids, viaCache);
+        for (size_t i = 0; i < ids.size() && same; i += 97) {
+            double unitPrice;
+            if (cache.lookup(ids[i], unitPrice))
+                same = unitPrice == uncached(ids[i]);
+        }
+        same = same && fabs(tree.second - cached.second) <= 1e-6 * fabs(tree.second);
+        cout << left << setw(12) << (round == 0 ? "Zipf(1)" : "Uniform") << fixed << setprecision(1)
+            << setw(16) << tree.first << setw(16) << cached.first
+            << setw(12) << setprecision(3) << cache.stats().hitRatio()
+            << setprecision(2) << tree.first / cached.first << "x\n";
+    }
+    cout << (same ? "Cached prices match the catalog.\n" : "FAILED: cached prices differ\n");
+    return same;
+}
+
+// --------------------- Promotion Benchmark ---------------------
+// Price random orders against growing rule sets, once through the compiled
+// plans and once by scanning every rule, and check both give the same totals.
+// Also times the first order after the current time window ends, which
+// should only swap in the plan built ahead for the next window.
+bool runPromotionBenchmark(long long orders) {
+    const int productCount = 10000;
+    const int categoryCount = 50;
+    vector<Product> catalog;
+    for (int id = 1; id <= productCount; id++) {
+        catalog.emplace_back(id, "Item", "Category" + to_string(id % categoryCount),
+            100 + id % 900, 1000, "2030-01-01", 5, 2);
+    }
+    time_t now = time(nullptr);
+    auto stamp = [](time_t when) {
+        tm local = toLocalTime(when);
+        char text[32];
+        strftime(text, sizeof(text), "%Y-%m-%d %H:%M", &local);
+        return string(text);
+    };
+
+    cout << "\nPromotion Pricing Benchmark (" << orders << " orders over "
+        << productCount << " products)\n";
+    cout << left << setw(10) << "Rules" << setw(10) << "Active" << setw(16) << "Compile (ms)"
+        << setw(20) << "Compiled (ns/order)" << setw(22) << "Rule scan (ns/order)" << "Window switch (us)\n";
+    cout << string(96, '-') << "\n";
+    bool ok = true;
+    for (int ruleCount : { 10, 100, 1000, 10000 }) {
+        mt19937 rng(ruleCount);
+        vector<Promotion> generated;
+        for (int i = 0; i < ruleCount; i++) {
+            Promotion promotion;
+            promotion.id = i + 1;
+            int kind = rng() % 10;
+            if (kind < 6) {
+                promotion.scope = "product";
+                promotion.target = to_string(1 + rng() % productCount);
+            }
+            else {
+                promotion.scope = "category";
+                promotion.target = "Category" + to_string(rng() % categoryCount);
+            }
+            if (kind % 5 == 4) {
+                promotion.type = "bxgy";
+                promotion.buy = 1 + rng() % 4;
+                promotion.getFree = 1;
             }
+            else {
+                promotion.type = "percent";
+                promotion.percentOff = 1 + rng() % 40;
+                promotion.minQuantity = 1 + rng() % 10;
+            }
+            int window = rng() % 10;  // Most running now, some over, some not yet started
+            promotion.starts = stamp(now + (window == 0 ? 86400 : -86400));
+            promotion.ends = stamp(now + (window == 1 ? -3600 : 86400));
+            generated.push_back(promotion);
+        }
 
-            switch (choice) {
-            case 1:
-                if (login()) {
-                    adminMenu();
+        PromotionEngine engine;
+        auto compileStart = chrono::steady_clock::now();
+        engine.load(generated);
+        auto plans = engine.plansAt(now);
+        double compileMs = chrono::duration<double, milli>(chrono::steady_clock::now() - compileStart).count();
+        vector<PromotionRule> rules;
+        for (const auto& promotion : generated) {
+            PromotionRule rule;
+            string error;
+            if (compilePromotionRule(promotion, rule, error))
+                rules.push_back(rule);
+        }
+
+        vector<pair<int, int>> workload;
+        mt19937 orderRng(7);
+        for (long long i = 0; i < orders; i++)
+            workload.emplace_back((int)(orderRng() % productCount), 1 + (int)(orderRng() % 12));
+
+        double compiledSum = 0;
+        auto start = chrono::steady_clock::now();
+        for (const auto& order : workload) {
+            const Product& product = catalog[order.first];
+            compiledSum += engine.orderTotal(product, finalUnitPrice(product), order.second, now);
+        }
+        double compiledNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / orders;
+
+        double scanSum = 0;
+        start = chrono::steady_clock::now();
+        for (const auto& order : workload) {
+            const Product& product = catalog[order.first];
+            double unitPrice = finalUnitPrice(product);
+            double best = unitPrice * order.second;
+            for (const auto& rule : rules) {
+                if (rule.activeAt(now) && (rule.byCategory ? rule.category == product.category
+                    : rule.productId == product.id))
+                    best = min(best, rule.orderTotal(unitPrice, order.second));
+            }
+            scanSum += best;
+        }
+        double scanNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / orders;
+
+        if (fabs(compiledSum - scanSum) > 1e-6 * max(1.0, scanSum)) {
+            cout << "Mismatch at " << ruleCount << " rules: " << compiledSum << " vs " << scanSum << "\n";
+            ok = false;
+        }
+
+        while (!engine.nextWindowReady())
+            this_thread::sleep_for(chrono::milliseconds(1));
+        time_t boundary = plans->validUntil;
+        start = chrono::steady_clock::now();
+        auto nextPlans = engine.plansAt(boundary);
+        double switchUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+        if (nextPlans->activeRules != CompiledPromotions(rules, boundary).activeRules) {
+            cout << "Next window plan differs at " << ruleCount << " rules\n";
+            ok = false;
+        }
+        cout << left << setw(10) << ruleCount << setw(10) << plans->activeRules << fixed
+            << setprecision(2) << setw(16) << compileMs << setprecision(1)
+            << setw(20) << compiledNs << setw(22) << scanNs << switchUs << "\n";
+    }
+    cout << (ok ? "Totals match.\n" : "FAILED\n");
+    return ok;
+}
+
+// --------------------- Memory Benchmark ---------------------
+// Build a catalog of the given size, print the footprint report and check
+// that every packed record unpacks to the product it came from. On glibc the
+// heap growth is also measured, as a check on the report's estimates.
+size_t heapInUse() {
+#ifdef __GLIBC__
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;  // Small blocks + large mmap()ed ones
+#else
+    return 0;
+#endif
+}
+
+bool runMemoryBenchmark(int productCount) {
+    static const char* const words[] = { "Stainless", "Steel", "Electric", "Kettle", "Ceiling",
+        "Fan", "Deluxe", "Compact", "Cordless", "Iron", "Oven", "Toaster", "Blender", "Lamp" };
+    ProductTree tree;
+    vector<Product> products;
+    products.reserve(productCount);
+    mt19937 rng(99);
+    for (int id = 1; id <= productCount; id++) {
+        string name = string(words[rng() % 14]) + " " + words[rng() % 14] + " " + words[rng() % 14]
+            + " " + to_string(rng() % 1000);
+        char date[16];
+        snprintf(date, sizeof(date), "20%02d-%02d-%02d", 25 + (int)(rng() % 5),
+            1 + (int)(rng() % 12), 1 + (int)(rng() % 28));
+        products.emplace_back(id, name, string("Category ") + words[rng() % 14],
+            (double)(rng() % 10000000) / 100, (int)(rng() % 500), date,
+            (double)(rng() % 50), (double)(rng() % 18));
+    }
+    size_t before = heapInUse();
+    tree.bulkMerge(products, [](Product&, const Product&) {});
+    size_t treeHeap = heapInUse() - before;
+    CatalogSnapshot catalog = tree.snapshot();
+
+    before = heapInUse();
+    PackedCatalog packed(catalog);
+    size_t packedHeap = heapInUse() - before;
+
+    printMemoryReport(catalog);
+    if (treeHeap > 0) {
+        cout << fixed << setprecision(1) << "Measured heap growth: tree "
+            << (double)treeHeap / productCount << " bytes/SKU, packed "
+            << (double)packedHeap / productCount << " bytes/SKU\n";
+    }
+
+    size_t mismatches = 0;
+    for (const auto& product : products) {
+        const PackedProduct* record = packed.search(product.id);
+        if (!record) {
+            mismatches++;
+            continue;
+        }
+        Product copy = packed.unpack(*record);
+        if (copy.name != product.name || copy.category != product.category || copy.Date != product.Date
+            || copy.quantity != product.quantity || fabs(copy.price - product.price) > 0.005
+            || fabs(copy.discount - product.discount) > 0.005 || fabs(copy.tax - product.tax) > 0.005)
+            mismatches++;
+    }
+    cout << (mismatches ? "FAILED: " + to_string(mismatches) + " products did not round-trip\n"
+        : string("All products round-trip through the packed catalog.\n"));
+    return mismatches == 0;
+}
+
+// --------------------- Sort Benchmark ---------------------
+// Time a two-key catalog sort (category, then descending final price) the
+// old way (copy every Product, then sort the copies) against index sorting
+// on one thread and on threads threads, and a cached repeat.
+bool runSortBenchmark(int productCount, int threads) {
+    vector<Product> products;
+    products.reserve(productCount);
+    mt19937 rng(5);
+    for (int id = 1; id <= productCount; id++) {
+        products.emplace_back(id, "Item " + to_string(id), "Category " + to_string(rng() % 200),
+            (double)(rng() % 1000000) / 100, (int)(rng() % 500), "2030-01-01",
+            (double)(rng() % 50), (double)(rng() % 18));
+    }
+    ProductTree tree;
+    tree.bulkMerge(products, [](Product&, const Product&) {});
+    CatalogSnapshot catalog = tree.snapshot();
+    vector<SortField> fields = { { SortKey::Category, false }, { SortKey::FinalPrice, true } };
+    auto timeMs = [](auto work) {
+        auto start = chrono::steady_clock::now();
+        work();
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    };
+
+    vector<Product> copies;
+    double copyMs = timeMs([&] {
+        copies = catalog.getAllProducts();
+        stable_sort(copies.begin(), copies.end(), [](const Product& a, const Product& b) {
+            if (a.category != b.category)
+                return a.category < b.category;
+            return finalUnitPrice(a) > finalUnitPrice(b);
+        });
+    });
+    shared_ptr<const SortedView> single, parallel;
+    double singleMs = timeMs([&] { single = CatalogSorter(1).view(catalog, fields); });
+    CatalogSorter sorter(threads);
+    double parallelMs = timeMs([&] { parallel = sorter.view(catalog, fields); });
+    double cachedMs = timeMs([&] { sorter.view(catalog, fields); });
+
+    bool same = parallel->size() == copies.size();
+    for (size_t i = 0; same && i < copies.size(); i++)
+        same = (*parallel)[i].id == copies[i].id && (*single)[i].id == copies[i].id;
+
+    cout << "\nSort Benchmark (" << productCount << " products, category then -final price)\n";
+    cout << string(60, '-') << "\n" << fixed << setprecision(2);
+    cout << left << setw(40) << "Copy Products + stable_sort" << copyMs << " ms\n";
+    cout << left << setw(40) << "Index sort, 1 thread" << singleMs << " ms\n";
+    cout << left << setw(40) << ("Index sort, " + to_string(threads) + " threads") << parallelMs << " ms\n";
+    cout << left << setw(40) << "Cached view (same version)" << cachedMs << " ms\n";
+    cout << (same ? "All orders agree.\n" : "FAILED: orders differ\n");
+    return same;
+}
+
+// --------------------- Search Benchmark ---------------------
+// Index a synthetic catalog (generated brand + adjective + noun names), time
+// misspelt queries, and check the index ranks exactly like scoring every
+// product directly, before and after a round of renames, deletes and adds.
+bool runSearchBenchmark(int productCount, int queryCount) {
+    static const char* const adjectives[] = { "Ceiling", "Table", "Electric", "Stainless", "Cordless",
+        "Compact", "Deluxe", "Portable", "Smart", "Wireless", "Digital", "Classic", "Outdoor", "Steel" };
+    static const char* const nouns[] = { "Light", "Lamp", "Fan", "Kettle", "Blender", "Toaster", "Iron",
+        "Oven", "Heater", "Speaker", "Charger", "Cooker", "Mixer", "Torch", "Bulb", "Grinder" };
+    static const char* const categories[] = { "Lighting", "Kitchen", "Cooling", "Audio", "Laundry",
+        "Heating", "Electronics", "Outdoor" };
+    static const char* const syllables[] = { "ra", "zo", "vek", "tan", "li", "mor", "qui", "sel",
+        "dun", "pha", "ko", "bri", "nex", "tor", "vu", "gal" };
+    mt19937 rng(17);
+    vector<string> brands;
+    for (int i = 0; i < 4000; i++) {
+        string brand;
+        for (int s = 0; s < 2 + (int)(rng() % 2); s++)
+            brand += syllables[rng() % 16];
+        brand[0] = (char)toupper((unsigned char)brand[0]);
+        brands.push_back(brand);
+    }
+    auto makeProduct = [&](int id) {
+        return Product(id, brands[rng() % brands.size()] + " " + adjectives[rng() % 14] + " " + nouns[rng() % 16],
+            categories[rng() % 8], (double)(rng() % 100000) / 100, (int)(rng() % 500), "2030-01-01", 0, 0);
+    };
+    vector<Product> products;
+    products.reserve(productCount);
+    for (int id = 1; id <= productCount; id++)
+        products.push_back(makeProduct(id));
+    ProductTree tree;
+    tree.bulkMerge(products, [](Product&, const Product&) {});
+
+    SearchIndex index;
+    auto start = chrono::steady_clock::now();
+    index.rebuild(tree.snapshot());
+    double buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    SearchIndex::Stats stats = index.stats();
+
+    // Misspell words of real names: swap, drop, double or change a letter
+    auto misspell = [&](string word) {
+        if (word.size() < 4)
+            return word;
+        size_t at = 1 + rng() % (word.size() - 2);
+        switch (rng() % 4) {
+        case 0: swap(word[at], word[at + 1]); break;
+        case 1: word.erase(at, 1); break;
+        case 2: word.insert(at, 1, word[at]); break;
+        default: word[at] = (char)('a' + rng() % 26); break;
+        }
+        return word;
+    };
+    vector<string> queries = { "lite", "ceiling lite", "electrik ketle", "stainles", "blendr kitchen" };
+    while ((int)queries.size() < queryCount) {
+        vector<string> words = SearchIndex::tokenize(products[rng() % products.size()].name);
+        string query = misspell(words[rng() % words.size()]);
+        if (rng() % 2)
+            query += " " + misspell(words[rng() % words.size()]);
+        queries.push_back(query);
+    }
+    vector<double> latencies;
+    for (const auto& query : queries) {
+        auto began = chrono::steady_clock::now();
+        index.search(query, 10);
+        latencies.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - began).count());
+    }
+    double meanMs = accumulate(latencies.begin(), latencies.end(), 0.0) / latencies.size();
+    sort(latencies.begin(), latencies.end());
+
+    // Top 10 by scoring every product, for comparison
+    auto sameAsScan = [&](const string& query) {
+        vector<string> words = SearchIndex::tokenize(query);
+        vector<SearchIndex::Match> scanned;
+        tree.snapshot().forEach([&](const Product& product) {
+            int score = SearchIndex::scoreProduct(words, product);
+            if (score > 0)
+                scanned.push_back({ product.id, score });
+        });
+        auto better = [](const SearchIndex::Match& a, const SearchIndex::Match& b) {
+            return a.score != b.score ? a.score > b.score : a.id < b.id;
+        };
+        size_t shown = min<size_t>(10, scanned.size());
+        partial_sort(scanned.begin(), scanned.begin() + shown, scanned.end(), better);
+        scanned.resize(shown);
+        vector<SearchIndex::Match> found = index.search(query, 10);
+        bool same = found.size() == scanned.size();
+        for (size_t i = 0; same && i < found.size(); i++)
+            same = found[i].id == scanned[i].id && found[i].score == scanned[i].score;
+        if (!same)
+            cout << "FAILED: ranking for \"" << query << "\" differs from a full scan\n";
+        return same;
+    };
+    bool same = true;
+    for (size_t i = 0; i < 4; i++)
+        same = sameAsScan(queries[i]) && same;
+
+    // Incremental maintenance: rename, delete and add 1000 products each
+    const int changes = min(1000, productCount / 3);
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < changes; i++) {
+        int id = 1 + (int)(rng() % productCount);
+        const Product* stored = tree.search(id);
+        if (!stored)
+            continue;
+        Product renamed = makeProduct(id);
+        index.update(*stored, renamed);
+        tree.replace(renamed);
+    }
+    for (int i = 0; i < changes; i++) {
+        int id = 1 + (int)(rng() % productCount);
+        if (const Product* stored = tree.search(id)) {
+            index.remove(*stored);
+            tree.deleteProduct(id);
+        }
+    }
+    for (int i = 0; i < changes; i++) {
+        Product added = makeProduct(productCount + 1 + i);
+        tree.insert(added);
+        index.add(added);
+    }
+    double updateUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count()
+        / max(1, 3 * changes);
+    for (size_t i = 4; i < 7 && i < queries.size(); i++)
+        same = sameAsScan(queries[i]) && same;
+
+    CatalogSnapshot catalog = tree.snapshot();
+    cout << "\nSearch Benchmark (" << productCount << " products, " << stats.words << " distinct words, "
+        << stats.trigrams << " trigrams)\n";
+    cout << string(60, '-') << "\n" << fixed << setprecision(3);
+    cout << left << setw(40) << "Index build" << buildMs << " ms\n";
+    cout << left << setw(40) << ("Query (" + to_string(queries.size()) + " misspelt, top 10)")
+        << "mean " << meanMs << " ms, p50 " << latencies[latencies.size() / 2]
+        << " ms, p99 " << latencies[latencies.size() * 99 / 100] << " ms, max " << latencies.back() << " ms\n";
+    cout << left << setw(40) << "Rename / delete / add (tree + index)" << updateUs << " us each\n";
+    cout << "\nTop matches for \"lite\":\n";
+    for (const auto& match : index.search("lite", 3)) {
+        if (const Product* product = catalog.search(match.id))
+            cout << "  " << setw(8) << match.id << setw(32) << product->name << product->category << "\n";
+    }
+    cout << (same ? "Rankings agree with a full scan.\n" : "FAILED: rankings differ\n");
+    return same;
+}
+
+// --------------------- MVCC Self-Test ---------------------
+// Places orders on several threads while another thread keeps valuing the
+// catalog. Each sale removes one unit and publishes exactly one version, so a
+// consistent snapshot must hold initialUnits - (version - startVersion) units.
+// Any other total means a report observed torn state.
+bool runMvccSelfTest(int seconds, int orderThreads) {
+    const int productCount = 10000;
+    const int unitsPerProduct = 1000000;
+    ProductTree tree;
+    for (int id = 1; id <= productCount; id++)
+        tree.insert(Product(id, "Item", "Test", 100.0, unitsPerProduct, "2025-01-01", 10, 5));
+    const unsigned long long startVersion = tree.snapshot().getVersion();
+    const long long initialUnits = (long long)productCount * unitsPerProduct;
+    const double unitPrice = finalUnitPrice(Product(0, "", "", 100.0, 0, "", 10, 5));
+
+    atomic<bool> stop{ false };
+    atomic<long long> sales{ 0 };
+    atomic<long long> reports{ 0 };
+    atomic<long long> violations{ 0 };
+    vector<thread> workers;
+    for (int t = 0; t < orderThreads; t++) {
+        workers.emplace_back([&, t] {
+            mt19937 rng(t + 1);
+            while (!stop) {
+                int id = 1 + (int)(rng() % productCount);
+                bool sold = tree.update(id, [](Product& product) {
+                    if (product.quantity < 1)
+                        return false;
+                    product.quantity -= 1;
+                    return true;
+                });
+                if (sold)
+                    ++sales;
+            }
+        });
+    }
+    workers.emplace_back([&] {
+        while (!stop) {
+            CatalogSnapshot catalog = tree.snapshot();
+            long long units = 0;
+            catalog.forEach([&](const Product& product) { units += product.quantity; });
+            double value = inventoryValue(catalog);
+            long long expectedUnits = initialUnits - (long long)(catalog.getVersion() - startVersion);
+            double expectedValue = expectedUnits * unitPrice;
+            if (units != expectedUnits || fabs(value - expectedValue) > expectedValue * 1e-9)
+                ++violations;
+            ++reports;
+        }
+    });
+
+    this_thread::sleep_for(chrono::seconds(seconds));
+    stop = true;
+    for (auto& worker : workers)
+        worker.join();
+
+    long long finalUnits = 0;
+    tree.snapshot().forEach([&](const Product& product) { finalUnits += product.quantity; });
+    bool passed = violations == 0 && reports > 0 && finalUnits == initialUnits - sales;
+
+    cout << "\nMVCC Self-Test\n";
+    cout << "----------------------------------------\n";
+    cout << "Order threads:      " << orderThreads << "\n";
+    cout << "Orders placed:      " << sales << " (" << sales / seconds << "/s)\n";
+    cout << "Valuation reports:  " << reports << "\n";
+    cout << "Torn snapshots:     " << violations << "\n";
+    cout << "Final stock check:  " << (finalUnits == initialUnits - sales ? "ok" : "MISMATCH") << "\n";
+    cout << (passed ? "PASSED" : "FAILED") << "\n";
+    return passed;
+}
+
+// --------------------- Command Line Modes ---------------------
+void printUsage(const char* program) {
+    cout << "Usage:\n"
+        << "  " << program << "                      interactive terminal\n"
+        << "  " << program << " --server <endpoint>  serve order/lookup requests\n"
+        << "  " << program << " --loadgen <endpoint> [connections] [requests] [depth] [max id] [order %]\n"
+        << "  " << program << " --shard-split <shards> [hash|range]   split products.csv into shards\n"
+        << "  " << program << " --shard-router <endpoint>             run shard workers behind a router\n"
+        << "  " << program << " --bench-shards [max shards] [requests] [products]\n"
+        << "  " << program << " --replay                 rebuild products.csv from its snapshot + orderlog.csv\n"
+        << "  " << program << " --replay-load <endpoint> [speed] [log]   re-send logged orders (speed 0 = flat out)\n"
+        << "  " << program << " --bench-orders [orders] [register threads]\n"
+        << "  " << program << " --bench-holds [holds]\n"
+        << "  " << program << " --bench-price-cache [products] [quotes]\n"
+        << "  " << program << " --bench-promotions [orders]\n"
+        << "  " << program << " --bench-memory [products]\n"
+        << "  " << program << " --bench-sort [products] [threads]\n"
+        << "  " << program << " --bench-search [products] [queries]\n"
+        << "  " << program << " --selftest-mvcc [seconds] [order threads]\n"
+        << "  " << program << " --selftest-import\n"
+        << "Options (any mode): --durability async|written|fsync   --inline-io\n"
+        << "Endpoints: unix:/path/to.sock or tcp:PORT (localhost)\n";
+}
+
+// Optional numeric argument; throws if present but not a number
+long long numericArgument(int argc, char* argv[], int index, long long fallback) {
+    return argc > index ? stoll(argv[index]) : fallback;
+}
+
+int runCommandLine(int argc, char* argv[]) {
+    string mode = argv[1];
+    try {
+        if (mode == "--selftest-mvcc") {
+            int seconds = (int)numericArgument(argc, argv, 2, 3);
+            int threads = (int)numericArgument(argc, argv, 3, 2);
+            if (seconds >= 1 && threads >= 1)
+                return runMvccSelfTest(seconds, threads) ? 0 : 1;
+        }
+        else if (mode == "--replay") {
+            PointOfSaleSystem system;
+            const ReplayStats& stats = system.replayStats();
+            cout << "\nOrder Log Recovery\n";
+            cout << "----------------------------------------\n";
+            cout << "Snapshot holds sales up to: " << stats.snapshotSequence << "\n";
+            cout << "Log rows read:              " << stats.records << " (" << stats.malformed << " malformed)\n";
+            cout << "Sales replayed:             " << stats.replayed << " onto " << stats.productsTouched
+                << " products (" << stats.unknownProducts << " unknown products skipped)\n";
+            cout << "Catalog now at sale:        " << stats.lastSequence << "\n";
+            cout << fixed << setprecision(2) << "Recovery time:              " << stats.seconds * 1000 << " ms";
+            if (stats.records > 0 && stats.seconds > 0)
+                cout << " (" << setprecision(0) << stats.records / stats.seconds << " rows/s)";
+            cout << "\n";
+            return 0;
+        }
+        else if (mode == "--bench-sort") {
+            int products = (int)numericArgument(argc, argv, 2, 1000000);
+            int threads = (int)numericArgument(argc, argv, 3, max(1u, thread::hardware_concurrency()));
+            if (products >= 1 && threads >= 1)
+                return runSortBenchmark(products, threads) ? 0 : 1;
+        }
+        else if (mode == "--bench-search") {
+            int products = (int)numericArgument(argc, argv, 2, 1000000);
+            int queries = (int)numericArgument(argc, argv, 3, 1000);
+            if (products >= 3 && queries >= 7)
+                return runSearchBenchmark(products, queries) ? 0 : 1;
+        }
+        else if (mode == "--bench-memory") {
+            int products = (int)numericArgument(argc, argv, 2, 1000000);
+            if (products >= 1)
+                return runMemoryBenchmark(products) ? 0 : 1;
+        }
+        else if (mode == "--bench-price-cache") {
+            int products = (int)numericArgument(argc, argv, 2, 1000000);
+            int quotes = (int)numericArgument(argc, argv, 3, 5000000);
+            if (products >= 1 && quotes >= 1)
+                return runPriceCacheBenchmark(products, quotes) ? 0 : 1;
+        }
+        else if (mode == "--bench-promotions") {
+            long long orders = numericArgument(argc, argv, 2, 1000000);
+            if (orders >= 1)
+                return runPromotionBenchmark(orders) ? 0 : 1;
+        }
+#ifdef __linux__
+        else if ((mode == "--server" || mode == "--loadgen" || mode == "--shard-router") && argc >= 3) {
+            Endpoint endpoint;
+            if (!parseEndpoint(argv[2], endpoint)) {
+                cout << "Invalid endpoint: " << argv[2] << "\n";
+                return 1;
+            }
+            if (mode == "--server") {
+                PointOfSaleSystem system;
+                OrderServer server(system, endpoint);
+                return server.run() ? 0 : 1;
+            }
+            if (mode == "--shard-router") {
+                ShardMap map;
+                if (!map.load("shards.csv")) {
+                    cout << "No valid shards.csv found. Run --shard-split first.\n";
+                    return 1;
                 }
-                break;
-            case 2:
-                customerMenu();
-                break;
-            case 3:
-                cout << "\nExiting Program... Goodbye!\n";
-                break;
-            default:
-                cout << "\nInvalid choice. Please try again.\n";
+                vector<pid_t> workers = startShardWorkers(map, false);
+                bool ok;
+                {
+                    ShardRouter router(map, endpoint);
+                    ok = router.run();
+                }
+                stopShardWorkers(workers);
+                return ok ? 0 : 1;
             }
-        } while (choice != 3);
+            int connections = (int)numericArgument(argc, argv, 3, 4);
+            long long requests = numericArgument(argc, argv, 4, 100000);
+            int depth = (int)numericArgument(argc, argv, 5, 16);
+            int maxId = (int)numericArgument(argc, argv, 6, 17);
+            int orderPercent = (int)numericArgument(argc, argv, 7, 10);
+            if (connections >= 1 && requests >= 1 && depth >= 1 && maxId >= 1) {
+                LoadGenerator generator({ endpoint }, ShardMap::hashed(1), connections,
+                    requests, depth, maxId, orderPercent);
+                LoadTestResult result;
+                if (!generator.run(result))
+                    return 1;
+                generator.printReport(result);
+                return 0;
+            }
+        }
+        else if (mode == "--replay-load" && argc >= 3) {
+            Endpoint endpoint;
+            if (!parseEndpoint(argv[2], endpoint)) {
+                cout << "Invalid endpoint: " << argv[2] << "\n";
+                return 1;
+            }
+            double speed = argc > 3 ? stod(argv[3]) : 1.0;
+            string log = argc > 4 ? argv[4] : "orderlog.csv";
+            if (speed >= 0)
+                return runReplayLoad(endpoint, log, speed) ? 0 : 1;
+        }
+        else if (mode == "--shard-split" && argc >= 3) {
+            int count = stoi(argv[2]);
+            string kind = argc > 3 ? argv[3] : "hash";
+            if (count >= 1 && (kind == "hash" || kind == "range")) {
+                ShardMap map = ShardMap::hashed(count);
+                if (kind == "range") {
+                    vector<int> ids;
+                    ifstream file("products.csv");
+                    string line;
+                    Product product;
+                    while (getline(file, line))
+                        if (parseProductCSV(line, product))
+                            ids.push_back(product.id);
+                    sort(ids.begin(), ids.end());
+                    map = ShardMap::ranged(ids, count);
+                }
+                if (!splitCatalogIntoShards("products.csv", map))
+                    return 1;
+                cout << "Catalog split into " << count << " shards (" << kind << ").\n";
+                return 0;
+            }
+        }
+        else if (mode == "--bench-orders") {
+            long long orders = numericArgument(argc, argv, 2, 20000);
+            int threads = (int)numericArgument(argc, argv, 3, 1);
+            if (orders >= 1 && threads >= 1)
+                return runOrderLatencyBenchmark(orders, threads) ? 0 : 1;
+        }
+        else if (mode == "--bench-holds") {
+            int holds = (int)numericArgument(argc, argv, 2, 100000);
+            if (holds >= 3)
+                return runReservationBenchmark(holds) ? 0 : 1;
+        }
+        else if (mode == "--selftest-import") {
+            return runImportSelfTest() ? 0 : 1;
+        }
+        else if (mode == "--bench-shards") {
+            int maxShards = (int)numericArgument(argc, argv, 2, 4);
+            long long requests = numericArgument(argc, argv, 3, 200000);
+            int products = (int)numericArgument(argc, argv, 4, 100000);
+            if (maxShards >= 1 && requests >= 1 && products >= 1)
+                return runShardBenchmark(maxShards, requests, products) ? 0 : 1;
+        }
+#else
+        else if (mode != "--help") {
+            cout << "Server and shard modes are only available on Linux.\n";
+            return 1;
+        }
+#endif
     }
-};
+    catch (...) {
+        // Fall through to the usage text
+    }
+    printUsage(argv[0]);
+    return 1;
+}
+
+// Take the persistence options out of argv, leaving the mode arguments.
+// Returns false on an unknown durability level.
+bool extractPersistenceOptions(int& argc, char* argv[]) {
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--inline-io") {
+            persistenceOptions.journalIoThread = false;
+        }
+        else if (arg == "--durability" && i + 1 < argc) {
+            string level = argv[++i];
+            if (level == "async")
+                persistenceOptions.durability = Durability::Async;
+            else if (level == "written")
+                persistenceOptions.durability = Durability::Written;
+            else if (level == "fsync")
+                persistenceOptions.durability = Durability::Synced;
+            else
+                return false;
+        }
+        else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+    return true;
+}
 
-int main() {
+int main(int argc, char* argv[]) {
+    if (!extractPersistenceOptions(argc, argv)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (argc > 1)
+        return runCommandLine(argc, argv);
     PointOfSaleSystem system;
     system.startProgram();
     return 0;
-}
\ No newline at end of file
+}